@@ -14,4 +14,36 @@ LINK_DIRECTORIES(
 	D:/MINGW64/mingw64/lib
 	D:/MINGW64/mingw64/x86_64-w64-mingw32/lib
 	E:/LLVM/lib
-)
\ No newline at end of file
+)
+# build the parser tables once, wc includes them with WC_PRECOMPILED_TABLES
+ADD_EXECUTABLE(wcgen wcgen.cpp)
+ADD_CUSTOM_COMMAND(
+	OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/wc_tables.h
+	COMMAND wcgen ${CMAKE_CURRENT_BINARY_DIR}/wc_tables.h
+	DEPENDS wcgen wc.h parser.h parser.cpp lexer.h lexer.cpp dfa.h dfa.cpp
+)
+ADD_EXECUTABLE(wc wc.cpp ${CMAKE_CURRENT_BINARY_DIR}/wc_tables.h)
+TARGET_INCLUDE_DIRECTORIES(wc PRIVATE ${CMAKE_CURRENT_BINARY_DIR})
+TARGET_COMPILE_DEFINITIONS(wc PRIVATE WC_PRECOMPILED_TABLES)
+
+# the libraries of some llvm components, in the order llvm-config gives them to the linker
+FIND_PROGRAM(LLVM_CONFIG llvm-config PATHS E:/LLVM/bin)
+MACRO(LLVM_LIBS var)
+	EXECUTE_PROCESS(COMMAND ${LLVM_CONFIG} --libs ${ARGN} --system-libs
+		OUTPUT_VARIABLE ${var} OUTPUT_STRIP_TRAILING_WHITESPACE)
+	SEPARATE_ARGUMENTS(${var} UNIX_COMMAND "${${var}}")
+ENDMACRO()
+SET(WC_COMPONENTS core support ipo vectorize all-targets)
+# -lld links in process with the lld 3.8 libraries, they come before the llvm ones they use
+OPTION(WC_LLD "link executables with the lld library" OFF)
+IF(WC_LLD)
+	TARGET_COMPILE_DEFINITIONS(wc PRIVATE WC_LLD)
+	TARGET_LINK_LIBRARIES(wc lldELF2 lldConfig)
+	LIST(APPEND WC_COMPONENTS object option)
+ENDIF()
+LLVM_LIBS(WCGEN_LIBS core support)
+LLVM_LIBS(WC_LIBS ${WC_COMPONENTS})
+# the lexer runs on std::thread
+FIND_PACKAGE(Threads REQUIRED)
+TARGET_LINK_LIBRARIES(wcgen ${WCGEN_LIBS} ${CMAKE_THREAD_LIBS_INIT})
+TARGET_LINK_LIBRARIES(wc ${WC_LIBS} ${CMAKE_THREAD_LIBS_INIT})
@@ -0,0 +1,544 @@
+namespace lr_parser
+{
+
+const dfa::state dfa::dead_state = 0;
+
+// nfa
+nfa::nfa()
+{
+	new_state();		// start state, links to all the rules
+}
+
+int nfa::new_state()
+{
+	states.emplace_back();
+	states.back().owner = owner;
+	return states.size() - 1;
+}
+
+void nfa::add_rule(const std::string& m, int rule_id, bool ic)
+{
+	mode = m;
+	pos = 0;
+	owner = rule_id;
+	icase = ic;
+	if (lazy.size() <= static_cast<unsigned>(rule_id)) lazy.resize(rule_id + 1);
+	auto f = alternative();
+	if (pos != mode.size()) invalid();
+	states[f.end].accept = rule_id;
+	states[0].eps.push_back(f.begin);
+}
+
+nfa::fragment nfa::alternative()
+{
+	auto f = sequence();
+	while (pos < mode.size() && mode[pos] == '|')
+	{
+		++pos;
+		auto g = sequence();
+		int b = new_state(), e = new_state();
+		states[b].eps = { f.begin, g.begin };
+		states[f.end].eps.push_back(e);
+		states[g.end].eps.push_back(e);
+		f = { b, e };
+	}
+	return f;
+}
+
+nfa::fragment nfa::sequence()
+{
+	int b = new_state();
+	fragment f = { b, b };
+	while (pos < mode.size() && mode[pos] != '|' && mode[pos] != ')')
+	{
+		auto g = repeat();
+		states[f.end].eps.push_back(g.begin);
+		f.end = g.end;
+	}
+	return f;
+}
+
+nfa::fragment nfa::repeat()
+{
+	auto f = atom();
+	while (pos < mode.size() && strchr("*+?", mode[pos]))
+	{
+		char q = mode[pos++];
+		if (pos < mode.size() && mode[pos] == '?')
+		{	// a lazy rule stops at its first match instead of the longest one
+			++pos;
+			lazy[owner] = true;
+		}
+		int b = new_state(), e = new_state();
+		states[b].eps.push_back(f.begin);
+		if (q != '+') states[b].eps.push_back(e);
+		states[f.end].eps.push_back(e);
+		if (q != '?') states[f.end].eps.push_back(f.begin);
+		f = { b, e };
+	}
+	if (pos < mode.size() && mode[pos] == '{') invalid();		// counted repeat
+	return f;
+}
+
+nfa::fragment nfa::atom()
+{
+	char_set chars;
+	switch (char c = mode[pos++])
+	{
+	case '(': {
+		if (!mode.compare(pos, 2, "?:")) pos += 2;
+		else if (pos < mode.size() && mode[pos] == '?') invalid();
+		auto f = alternative();
+		if (pos >= mode.size() || mode[pos++] != ')') invalid();
+		return f;
+	}
+	case '[': chars = char_class(); break;
+	case '.': chars.set(); chars.reset('\n'); chars.reset('\r'); break;
+	case '\\': chars = escape(false); break;
+	case '^': case '$': case '*': case '+': case '?': case '{': invalid();
+	default: chars = single(c);
+	}
+	chars.reset(0);		// the input ends at '\0'
+	int b = new_state(), e = new_state();
+	states[b].chars = chars;
+	states[b].next = e;
+	return { b, e };
+}
+
+nfa::char_set nfa::char_class()
+{
+	char_set chars;
+	bool negate = pos < mode.size() && mode[pos] == '^';
+	if (negate) ++pos;
+	while (true)
+	{
+		if (pos >= mode.size()) invalid();
+		char c = mode[pos++];
+		if (c == ']') break;
+		if (c == '\\')
+		{
+			chars |= escape(true);
+		}
+		else if (pos + 1 < mode.size() && mode[pos] == '-' && mode[pos + 1] != ']')
+		{
+			unsigned char last = mode[pos + 1];
+			if (last == '\\') invalid();
+			pos += 2;
+			for (unsigned ch = static_cast<unsigned char>(c); ch <= last; ++ch)
+				chars |= single(ch);
+		}
+		else chars |= single(c);
+	}
+	if (negate) chars.flip();
+	return chars;
+}
+
+nfa::char_set nfa::escape(bool in_class)
+{
+	if (pos >= mode.size()) invalid();
+	char c = mode[pos++];
+	char_set chars;
+	switch (c)
+	{
+	case 'd': case 'D':
+		for (char ch = '0'; ch <= '9'; ++ch) chars.set(ch);
+		break;
+	case 'w': case 'W':
+		for (unsigned ch = 1; ch != 256; ++ch) if (dfa::is_word(ch)) chars.set(ch);
+		break;
+	case 's': case 'S':
+		for (auto ch: " \t\n\r\f\v") chars.set(static_cast<unsigned char>(ch));
+		chars.reset(0);
+		break;
+	case 'n': return single('\n');
+	case 't': return single('\t');
+	case 'r': return single('\r');
+	case 'f': return single('\f');
+	case 'v': return single('\v');
+	case 'b':
+		if (in_class) return single('\b');		// word boundary is a rule option
+		invalid();
+	case 'B': invalid();
+	default: return single(c);
+	}
+	if (isupper(c)) chars.flip();
+	return chars;
+}
+
+nfa::char_set nfa::single(char c) const
+{
+	char_set chars;
+	chars.set(static_cast<unsigned char>(c));
+	if (icase && isalpha(static_cast<unsigned char>(c)))
+	{
+		chars.set(tolower(static_cast<unsigned char>(c)));
+		chars.set(toupper(static_cast<unsigned char>(c)));
+	}
+	return chars;
+}
+
+void nfa::invalid() const
+{
+	throw regex_err("invalid regular expression: " + mode);
+}
+
+// dfa
+dfa::dfa(const std::vector<rule>& rules)
+{
+	nfa N;
+	std::map<std::string, int> keywords;		// the first rule of each word
+	for (unsigned i = 0; i != rules.size(); ++i)
+	{
+		if (is_keyword(rules[i])) keywords.insert({ rules[i].mode, i });
+		else if (rules[i].mode != "")
+			N.add_rule(rules[i].mode, i, rules[i].ignore_case);
+	}
+	const int word_rule = rules.size();		// any word, a keyword if it is found in the hash
+	if (!keywords.empty()) N.add_rule("\\w+", word_rule, false);
+	N.lazy.resize(rules.size() + 1);
+
+	// split chars into classes that no char set can tell apart
+	unsigned char_class[256] = {}, class_count = 1;
+	std::set<std::string> visited;
+	for (auto& s: N.states)
+	{
+		if (s.next >= 0 && visited.insert(s.chars.to_string()).second)
+		{
+			std::map<std::pair<unsigned, bool>, unsigned> refine;
+			for (unsigned c = 0; c != 256; ++c)
+				char_class[c] = refine.insert({{ char_class[c], s.chars[c] }, static_cast<unsigned>(refine.size())}).first->second;
+			class_count = refine.size();
+		}
+	}
+	std::vector<unsigned> sample(class_count);
+	for (unsigned c = 0; c != 256; ++c) sample[char_class[c]] = c;
+
+	// subset construction
+	using item_set = std::vector<int>;
+	std::vector<char> mark(N.states.size());
+	auto closure = [&](item_set I)
+	{
+		for (auto s: I) mark[s] = 1;
+		for (unsigned i = 0; i != I.size(); ++i)
+		{
+			for (auto t: N.states[I[i]].eps)
+				if (!mark[t]) { mark[t] = 1; I.push_back(t); }
+		}
+		for (auto s: I)
+		{	// a lazy rule drops its other threads once it accepts
+			auto r_id = N.states[s].accept;
+			if (r_id >= 0 && N.lazy[r_id])
+				for (auto t: I) if (N.states[t].owner == r_id && t != s) mark[t] = 0;
+		}
+		item_set res;
+		for (auto s: I) if (mark[s]) res.push_back(s);
+		for (auto s: I) mark[s] = 0;
+		std::sort(res.begin(), res.end());
+		return res;
+	};
+	std::map<item_set, state> ids;
+	std::vector<item_set> sets;
+	auto id_of = [&](item_set&& I)
+	{
+		auto itr = ids.find(I);
+		if (itr != ids.end()) return itr->second;
+		ids.insert({ I, sets.size() });
+		sets.push_back(std::move(I));
+		return static_cast<state>(sets.size() - 1);
+	};
+	id_of({});		// dead state
+	auto init = id_of(closure({ 0 }));
+	std::vector<state> moves;		// [state * class_count + char_class] -> state
+	for (unsigned s = 0; s != sets.size(); ++s)
+	{
+		for (unsigned c = 0; c != class_count; ++c)
+		{
+			item_set I;
+			for (auto t: sets[s])
+				if (N.states[t].next >= 0 && N.states[t].chars[sample[c]]) I.push_back(N.states[t].next);
+			moves.push_back(I.empty() ? dead_state : id_of(closure(std::move(I))));
+		}
+	}
+	struct accept_item
+	{
+		int any = -1;			// the first rule accepted in this state
+		int not_word = -1;		// the first rule accepted without a word boundary
+		int keyword = 0;		// a word ends here
+	};
+	std::vector<accept_item> acc(sets.size());
+	for (unsigned s = 0; s != sets.size(); ++s)
+	{
+		for (auto t: sets[s])
+		{
+			auto r_id = N.states[t].accept;
+			if (r_id == word_rule) acc[s].keyword = 1;
+			if (r_id < 0 || r_id == word_rule) continue;
+			if (acc[s].any < 0 || r_id < acc[s].any) acc[s].any = r_id;
+			if (!rules[r_id].word && (acc[s].not_word < 0 || r_id < acc[s].not_word)) acc[s].not_word = r_id;
+		}
+	}
+
+	// minimize by refining the partition until it is stable
+	std::vector<int> block(sets.size());
+	unsigned count;
+	{
+		std::map<std::vector<int>, int> initial;
+		for (unsigned s = 0; s != sets.size(); ++s)
+			block[s] = initial.insert({{ acc[s].any, acc[s].not_word, acc[s].keyword }, static_cast<int>(initial.size())}).first->second;
+		count = initial.size();
+	}
+	while (true)
+	{
+		std::map<std::vector<int>, int> refine;
+		std::vector<int> next(sets.size());
+		for (unsigned s = 0; s != sets.size(); ++s)
+		{
+			std::vector<int> sig = { block[s] };
+			for (unsigned c = 0; c != class_count; ++c)
+				sig.push_back(block[moves[s * class_count + c]]);
+			next[s] = refine.insert({ std::move(sig), refine.size() }).first->second;
+		}
+		block.swap(next);
+		if (refine.size() == count) break;
+		count = refine.size();
+	}
+	std::vector<int> order(count, -1);
+	int n = 0;
+	order[block[dead_state]] = n++;
+	for (unsigned s = 0; s != sets.size(); ++s)
+		if (order[block[s]] < 0) order[block[s]] = n++;
+	// perfect hash of the keywords, the first hash picks a bucket and the seed
+	// of the bucket places its keywords into free slots by the second hash
+	unsigned buckets = 0, slots = 0, length = 0;
+	if (!keywords.empty())
+	{
+		buckets = slots = 1;
+		while (buckets * 4 < keywords.size()) buckets *= 2;
+		while (slots < keywords.size() * 2) slots *= 2;
+	}
+	struct keyword_item
+	{
+		unsigned hash;
+		int rule, offset;		// offset in the pool
+	};
+	std::vector<std::vector<keyword_item>> bucket(buckets);
+	for (auto& k: keywords)
+	{
+		auto h = keyword_hash(k.first.data(), k.first.data() + k.first.size());
+		length = std::max<unsigned>(length, k.first.size());
+		bucket[h & (buckets - 1)].push_back({ h, k.second, static_cast<int>(keyword_storage.size()) });
+		keyword_storage.insert(keyword_storage.end(), k.first.c_str(), k.first.c_str() + k.first.size() + 1);
+	}
+	std::vector<int> disp(buckets), slot(slots * 2, -1), by_size(buckets);
+	for (unsigned b = 0; b != buckets; ++b) by_size[b] = b;
+	std::stable_sort(by_size.begin(), by_size.end(), [&](int x, int y) { return bucket[x].size() > bucket[y].size(); });
+	for (auto b: by_size)
+	{
+		if (bucket[b].empty()) break;
+		for (unsigned seed = 1; ; ++seed)
+		{
+			if (seed == 1u << 20) throw err("cannot place the keywords in a perfect hash");
+			std::vector<unsigned> used;
+			for (auto& k: bucket[b])
+			{
+				auto i = keyword_mix(k.hash, seed) & (slots - 1);
+				if (slot[i * 2] >= 0 || std::count(used.begin(), used.end(), i)) break;
+				used.push_back(i);
+			}
+			if (used.size() != bucket[b].size()) continue;
+			for (unsigned j = 0; j != used.size(); ++j)
+			{
+				slot[used[j] * 2] = bucket[b][j].offset;
+				slot[used[j] * 2 + 1] = bucket[b][j].rule;
+			}
+			disp[b] = seed;
+			break;
+		}
+	}
+	// char classes, transitions, accepts, keywords
+	storage.resize(256 + count * class_count + count * 3);
+	std::copy(char_class, char_class + 256, storage.begin());
+	auto table = storage.data() + 256;
+	auto accept = table + count * class_count;
+	for (unsigned s = 0; s != sets.size(); ++s)
+	{
+		auto b = order[block[s]];
+		accept[b * 3] = acc[s].any;
+		accept[b * 3 + 1] = acc[s].not_word;
+		accept[b * 3 + 2] = acc[s].keyword;
+		for (unsigned c = 0; c != class_count; ++c)
+			table[b * class_count + c] = order[block[moves[s * class_count + c]]];
+	}
+	storage.insert(storage.end(), disp.begin(), disp.end());
+	storage.insert(storage.end(), slot.begin(), slot.end());
+	table = storage.data() + 256;
+	accept = table + count * class_count;
+	T = { storage.data(), static_cast<int>(class_count), table, accept,
+		static_cast<int>(count), order[block[init]], static_cast<int>(rules.size()),
+		keyword_storage.empty() ? "" : keyword_storage.data(), accept + count * 3, static_cast<int>(buckets),
+		accept + count * 3 + buckets, static_cast<int>(slots), static_cast<int>(length) };
+	find_runs();
+}
+
+bool dfa::is_keyword(const rule& r)
+{
+	if (!r.word || r.ignore_case || r.mode.empty()) return false;
+	for (auto c: r.mode) if (!is_word(c)) return false;
+	return true;
+}
+
+unsigned dfa::keyword_hash(pchar begin, pchar end)
+{	// fnv-1a
+	unsigned h = 2166136261u;
+	for (; begin != end; ++begin) h = (h ^ static_cast<unsigned char>(*begin)) * 16777619u;
+	return h;
+}
+
+unsigned dfa::keyword_mix(unsigned hash, unsigned seed)
+{	// the second hash only mixes the first one, the word is read once
+	hash ^= seed * 0x9e3779b9u;
+	hash = (hash ^ hash >> 16) * 0x85ebca6bu;
+	hash = (hash ^ hash >> 13) * 0xc2b2ae35u;
+	return hash ^ hash >> 16;
+}
+
+int dfa::keyword(pchar begin, pchar end) const
+{
+	if (end - begin > T.keyword_length) return -1;
+	auto h = keyword_hash(begin, end);
+	auto slot = T.keyword_slot + (keyword_mix(h, T.keyword_disp[h & (T.keyword_buckets - 1)]) & (T.keyword_slots - 1)) * 2;
+	if (slot[0] < 0) return -1;
+	auto word = T.keyword_pool + slot[0];
+	std::size_t n = end - begin;
+	return !strncmp(word, begin, n) && !word[n] ? slot[1] : -1;
+}
+
+void dfa::find_runs()
+{	// a run of these chars stays in the state, so the scanners can skip it at once
+	run.assign(T.state_count, no_run);
+	for (state s = 0; s != T.state_count; ++s)
+	{
+		if (s == dead_state) continue;
+		auto loops = [&](unsigned c) { return T.table[s * T.class_count + T.char_class[c]] == s; };
+		bool digits = true, word = true;
+		for (unsigned c = 1; c != 256; ++c)
+		{
+			if (is_digit(c)) digits = digits && loops(c);
+			if (is_word(c)) word = word && loops(c);
+		}
+		run[s] = word ? word_run : digits ? digit_run : no_run;
+	}
+}
+
+// bytes of a vector that belong to a run, as a bit mask
+#if defined(__GNUC__) && defined(__AVX2__)
+struct char_scan
+{
+	using vec = __m256i;
+	static const int size = 32;
+	static const unsigned full = 0xFFFFFFFFu;
+	static vec load(pchar p) { return _mm256_loadu_si256(reinterpret_cast<const vec*>(p)); }
+	static vec set(char c) { return _mm256_set1_epi8(c); }
+	static vec eq(vec a, char c) { return _mm256_cmpeq_epi8(a, set(c)); }
+	static vec in(vec a, char lo, char hi)
+		{ return _mm256_and_si256(_mm256_cmpgt_epi8(a, set(lo - 1)), _mm256_cmpgt_epi8(set(hi + 1), a)); }
+	static vec either(vec a, vec b) { return _mm256_or_si256(a, b); }
+	static vec lower(vec a) { return _mm256_or_si256(a, set(0x20)); }
+	static unsigned mask(vec a) { return _mm256_movemask_epi8(a); }
+};
+#define WC_CHAR_SCAN
+#elif defined(__GNUC__) && defined(__SSE2__)
+struct char_scan
+{
+	using vec = __m128i;
+	static const int size = 16;
+	static const unsigned full = 0xFFFFu;
+	static vec load(pchar p) { return _mm_loadu_si128(reinterpret_cast<const vec*>(p)); }
+	static vec set(char c) { return _mm_set1_epi8(c); }
+	static vec eq(vec a, char c) { return _mm_cmpeq_epi8(a, set(c)); }
+	static vec in(vec a, char lo, char hi)
+		{ return _mm_and_si128(_mm_cmpgt_epi8(a, set(lo - 1)), _mm_cmplt_epi8(a, set(hi + 1))); }
+	static vec either(vec a, vec b) { return _mm_or_si128(a, b); }
+	static vec lower(vec a) { return _mm_or_si128(a, set(0x20)); }
+	static unsigned mask(vec a) { return _mm_movemask_epi8(a); }
+};
+#define WC_CHAR_SCAN
+#endif
+
+pchar dfa::skip_spaces(pchar p, pchar limit)
+{
+#ifdef WC_CHAR_SCAN
+	using S = char_scan;
+	for (; limit - p >= S::size; p += S::size)
+	{
+		auto v = S::load(p);
+		unsigned m = ~S::mask(S::either(S::either(S::eq(v, ' '), S::eq(v, '\n')), S::either(S::eq(v, '\r'), S::eq(v, '\t')))) & S::full;
+		if (m) return p + __builtin_ctz(m);
+	}
+#endif
+	while (p != limit && is_space(*p)) ++p;
+	return p;
+}
+
+pchar dfa::skip_digits(pchar p, pchar limit)
+{
+#ifdef WC_CHAR_SCAN
+	using S = char_scan;
+	for (; limit - p >= S::size; p += S::size)
+	{
+		unsigned m = ~S::mask(S::in(S::load(p), '0', '9')) & S::full;
+		if (m) return p + __builtin_ctz(m);
+	}
+#endif
+	while (p != limit && is_digit(*p)) ++p;
+	return p;
+}
+
+pchar dfa::skip_word(pchar p, pchar limit)
+{
+#ifdef WC_CHAR_SCAN
+	using S = char_scan;
+	for (; limit - p >= S::size; p += S::size)
+	{
+		auto v = S::load(p);
+		unsigned m = ~S::mask(S::either(S::either(S::in(S::lower(v), 'a', 'z'), S::in(v, '0', '9')), S::eq(v, '_'))) & S::full;
+		if (m) return p + __builtin_ctz(m);
+	}
+#endif
+	while (p != limit && is_word(*p)) ++p;
+	return p;
+}
+
+int dfa::match(pchar p, pchar limit, pchar& end) const
+{
+	int r_id = -1;
+	pchar begin = p;
+	state s = T.start;
+	while (p != limit && (s = T.table[s * T.class_count + T.char_class[static_cast<unsigned char>(*p)]]) != dead_state)
+	{
+		auto acc = T.accept + s * 3;
+		++p;
+		switch (run[s])
+		{	// every char of the run would come back here, only its end can change the match
+		case digit_run: p = skip_digits(p, limit); break;
+		case word_run: p = skip_word(p, limit); break;
+		}
+		if (acc[0] >= 0 || acc[2])
+		{
+			bool boundary = is_word(p[-1]) != (p != limit && is_word(*p));
+			int best = acc[0] == acc[1] || boundary ? acc[0] : acc[1];
+			if (acc[2] && boundary)
+			{	// a keyword wins if it was declared before
+				auto k = keyword(begin, p);
+				if (k >= 0 && (best < 0 || k < best)) best = k;
+			}
+			if (best >= 0)
+			{
+				r_id = best; end = p;
+			}
+		}
+	}
+	return r_id;
+}
+
+}
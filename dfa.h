@@ -0,0 +1,141 @@
+#ifndef __LL_DFA__HEADER_FILE
+#define __LL_DFA__HEADER_FILE
+#include <bitset>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include "utility.h"
+#if defined(__GNUC__) && defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace lr_parser
+{
+
+// all the lexer rules merged into one minimized automaton
+// the longest match wins and the rule declared first wins a tie
+// a word rule of plain word chars (a keyword) is not put in the automaton, it matches
+// any word and the word is looked up in a perfect hash of the keywords
+class dfa
+{
+public:
+	using state = int;
+	struct rule
+	{
+		std::string mode;		// "" never matches
+		bool word;				// the match must end at a word boundary
+		bool ignore_case;
+	};
+	struct tables
+	{	// plain arrays, so an automaton can be precompiled
+		const int* char_class;		// [256]
+		int class_count;
+		const int* table;			// [state_count * class_count] -> state
+		const int* accept;			// [state_count * 3] first rule, first rule without word boundary, 1 if a keyword may end
+		int state_count;
+		int start;
+		int rule_count;
+		const char* keyword_pool;	// keywords separated by '\0'
+		const int* keyword_disp;	// [keyword_buckets] seed of the second hash of a bucket
+		int keyword_buckets;
+		const int* keyword_slot;	// [keyword_slots * 2] offset in the pool and rule, -1 if free
+		int keyword_slots;
+		int keyword_length;			// a longer word is no keyword
+	};
+	static const state dead_state;
+public:
+	dfa() = default;
+	dfa(const std::vector<rule>& rules);
+	// use the precompiled tables in place
+	dfa(const tables& t): T(t)
+		{ find_runs(); }
+	dfa(const dfa&) = delete;
+	dfa(dfa&&) = default;
+	dfa& operator = (const dfa&) = delete;
+	dfa& operator = (dfa&&) = default;
+public:
+	// match from p up to limit, returns the rule id or -1 and sets end behind the match
+	int match(pchar p, pchar limit, pchar& end) const;
+	const tables& get_tables() const
+		{ return T; }
+	static bool is_word(char c)
+		{ return isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+	static bool is_digit(char c)
+		{ return c >= '0' && c <= '9'; }
+	static bool is_space(char c)
+		{ return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+	// skip a run of such chars, a whole vector of bytes at a time with sse2 or avx2
+	static pchar skip_spaces(pchar p, pchar limit);
+	static pchar skip_digits(pchar p, pchar limit);
+	static pchar skip_word(pchar p, pchar limit);
+private:
+	// states that every digit or every word char leads back to
+	void find_runs();
+	// the keyword rule of a word, -1 if it is none
+	int keyword(pchar begin, pchar end) const;
+	static unsigned keyword_hash(pchar begin, pchar end);
+	static unsigned keyword_mix(unsigned hash, unsigned seed);
+	static bool is_keyword(const rule& r);
+private:
+	enum { no_run, digit_run, word_run };
+	std::vector<int> storage;		// owns the tables unless they are precompiled
+	std::vector<char> keyword_storage;		// a vector keeps its chars in place when the dfa is moved
+	tables T = { nullptr, 0, nullptr, nullptr, 0, dead_state, 0, "", nullptr, 0, nullptr, 0, 0 };
+	std::vector<char> run;			// [state]
+};
+
+// thompson construction for the regex subset used by the lexer rules
+class nfa
+{
+	friend class dfa;
+	using char_set = std::bitset<256>;
+	struct nfa_state
+	{
+		char_set chars;			// move to next on these chars
+		int next = -1;
+		std::vector<int> eps;
+		int owner = -1;			// the rule this state belongs to
+		int accept = -1;		// rule id if the rule ends here
+	};
+	struct fragment
+	{
+		int begin, end;
+	};
+public:
+	nfa();
+	// compile a rule and link it to the start state
+	void add_rule(const std::string& mode, int rule_id, bool icase);
+private:
+	int new_state();
+	fragment alternative();
+	fragment sequence();
+	fragment repeat();
+	fragment atom();
+	char_set char_class();
+	char_set escape(bool in_class);
+	char_set single(char c) const;
+	[[noreturn]] void invalid() const;
+private:
+	std::vector<nfa_state> states;
+	std::vector<bool> lazy;			// [rule] the rule matches the shortest string
+	// parsing state
+	std::string mode;
+	unsigned pos = 0;
+	int owner = -1;
+	bool icase = false;
+};
+
+struct regex_err: err
+{
+	regex_err(const std::string& s): err(s) {}
+};
+
+}
+
+#include "dfa.cpp"
+
+#endif
@@ -0,0 +1,85 @@
+namespace lr_parser
+{
+
+#ifdef _WIN32
+
+bool file_map::open(const std::string& path)
+{
+	close();
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER n;
+	if (!GetFileSizeEx(file, &n) || n.QuadPart == 0 ||
+		!(mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) ||
+		!(ptr = static_cast<pchar>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))))
+	{
+		close();
+		return false;
+	}
+	len = n.QuadPart;
+	return true;
+}
+
+void file_map::close()
+{
+	if (ptr) UnmapViewOfFile(ptr);
+	if (mapping) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	ptr = nullptr;
+	len = 0;
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool file_map::open(const std::string& path)
+{
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED)
+		{
+			ptr = static_cast<pchar>(p);
+			len = st.st_size;
+		}
+	}
+	::close(fd);		// the mapping stays valid
+	return ptr != nullptr;
+}
+
+void file_map::close()
+{
+	if (ptr) munmap(const_cast<char*>(ptr), len);
+	ptr = nullptr;
+	len = 0;
+}
+
+#endif
+
+bool write_file_atomic(const std::string& path, const std::string& data)
+{
+#ifdef _WIN32
+	auto tmp = path + "." + std::to_string(GetCurrentProcessId()) + ".tmp";
+#else
+	auto tmp = path + "." + std::to_string(getpid()) + ".tmp";
+#endif
+	FILE* f = fopen(tmp.c_str(), "wb");
+	if (!f) return false;
+	bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+	ok = fclose(f) == 0 && ok;
+#ifdef _WIN32
+	ok = ok && MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+	ok = ok && rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+	if (!ok) remove(tmp.c_str());
+	return ok;
+}
+
+}
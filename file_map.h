@@ -0,0 +1,55 @@
+#ifndef __LL_FILE_MAP__HEADER_FILE
+#define __LL_FILE_MAP__HEADER_FILE
+#include <string>
+#include <cstdio>
+#include <cstddef>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "utility.h"
+
+namespace lr_parser
+{
+
+// a read only view of a whole file
+class file_map
+{
+public:
+	file_map() = default;
+	file_map(const file_map&) = delete;
+	file_map& operator = (const file_map&) = delete;
+	~file_map()
+		{ close(); }
+public:
+	// returns false if the file cannot be mapped, empty files included
+	bool open(const std::string& path);
+	void close();
+	pchar data() const
+		{ return ptr; }
+	std::size_t size() const
+		{ return len; }
+private:
+	pchar ptr = nullptr;
+	std::size_t len = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+};
+
+// write to a temporary file and rename it to path, so readers never see a partial file
+bool write_file_atomic(const std::string& path, const std::string& data);
+
+}
+
+#include "file_map.cpp"
+
+#endif
@@ -3,92 +3,137 @@ namespace lr_parser
 
 lexer_base::lexer_base(const init_rules& iR)
 {	
+	std::vector<dfa::rule> modes;
 	for (auto& ir: iR)
-	{	// ^maches the beginning and white spaces are allowed
-		// catch the matching token and store it in the table
-		rule r;
-		r.token_name = ir.token_name;
-		std::string suffix = ir.opts.count(word) ? "\\b" : "";
-		//std::cout << prefix + ir.mode + suffix << std::endl;
-		if (ir.mode == "")
-			r.mode = std::regex("$^", std::regex::icase |		// never match
-				std::regex::nosubs | std::regex::optimize);
-		else if (ir.opts.count(ignore_case))
-			r.mode = std::regex(ir.mode + suffix, std::regex::icase |
-				std::regex::nosubs | std::regex::optimize);
-		else
-			r.mode = std::regex(ir.mode + suffix, std::regex::nosubs |
-				std::regex::optimize);
-		r.no_attr = ir.opts.count(no_attr);
-		rules_list.push_back(std::move(r));
+	{	// all the rules are merged into one automaton
+		// the first rule wins when two rules match the same length
+		modes.push_back({ ir.mode, ir.opts.count(word) != 0, ir.opts.count(ignore_case) != 0 });
+		rules_list.push_back({ ir.token_name, ir.opts.count(no_attr) != 0 });
 	}
+	automaton = dfa(modes);
 }
 
-void lexer_base::input(pchar p)
+lexer_base::lexer_base(const init_rules& iR, const dfa::tables& T):
+	automaton(T)
 {
-	ln = col = 0;
-	buffer = p;
-	cur_ptr = buffer.c_str();
-	ln_lookup[0] = cur_ptr;
-	while (spaces.count(*cur_ptr))
+	if (static_cast<unsigned>(T.rule_count) != iR.size())
+		throw err("precompiled lexer tables do not match the lexer rules");
+	for (auto& ir: iR)
 	{
-		if (*cur_ptr == '\n')
-		{
-			ln_lookup[++ln] = cur_ptr + 1;
-			col = 0;
-		}
-		else ++col;
-		++cur_ptr;
+		rules_list.push_back({ ir.token_name, ir.opts.count(no_attr) != 0 });
 	}
 }
 
-token lexer_base::next_token()
+void lexer_base::input(pchar p, std::size_t n)
+{
+	if (n > 0xFFFFFFFFu) throw err("input larger than 4GB");		// tokens keep 32-bit offsets
+	src = cur_ptr = p;
+	src_end = p + n;
+	cur_ptr = dfa::skip_spaces(cur_ptr, src_end);
+	ahead.clear();
+	ahead_pos = 0;
+}
+
+pchar lexer_base::lex_until(pchar p, pchar limit, std::vector<token>& tokens) const
 {
-	if (cur_ptr && *cur_ptr)
+	pchar end;
+	while (p < limit)
 	{
-		std::cmatch m;
-		for (auto& p: rules_list)
+		int r_id = automaton.match(p, src_end, end);
+		if (r_id < 0) break;
+		tokens.emplace_back(r_id, p - src, end - p);
+		p = dfa::skip_spaces(end, src_end);
+	}
+	return p;
+}
+
+void lexer_base::lex_ahead(unsigned threads)
+{	// a match only depends on the chars from where it starts, so a chunk lexed from a
+	// guessed token start is right from its first token where the chunk before ends
+	const std::size_t min_chunk = 1 << 18;
+	if (!cur_ptr) return;
+	std::size_t n = src_end - cur_ptr;
+	unsigned chunks = std::min<std::size_t>(threads, n / min_chunk);
+	if (chunks < 2) return;
+	std::vector<pchar> begin(chunks + 1);
+	begin[0] = cur_ptr;
+	begin[chunks] = src_end;
+	for (unsigned i = 1; i != chunks; ++i)
+	{	// guess a token starts behind a newline
+		auto p = std::max(cur_ptr + n / chunks * i, begin[i - 1]);
+		auto q = static_cast<pchar>(memchr(p, '\n', src_end - p));
+		begin[i] = q ? dfa::skip_spaces(q + 1, src_end) : src_end;
+	}
+	std::vector<std::vector<token>> tokens(chunks);
+	std::vector<pchar> stop(chunks);
+	std::vector<std::thread> workers;
+	for (unsigned i = 1; i != chunks; ++i)
+		workers.emplace_back([&, i] { stop[i] = lex_until(begin[i], begin[i + 1], tokens[i]); });
+	auto p = lex_until(begin[0], begin[1], ahead);
+	for (auto& w: workers) w.join();
+	for (unsigned i = 1; i != chunks && p >= begin[i]; ++i)
+	{	// the tokens of the chunk before may end anywhere in this one
+		auto& c = tokens[i];
+		auto at = std::lower_bound(c.begin(), c.end(), static_cast<unsigned>(p - src),
+			[](const token& t, unsigned offset) { return t.offset < offset; });
+		if (at != c.end() && at->offset == p - src)
 		{
-			if (std::regex_search(cur_ptr, m, p.mode, std::regex_constants::match_continuous))
-			{
-				unsigned LN = ln, COL = col;
-				while (cur_ptr != m.suffix().first)
-				{
-					if (*cur_ptr == '\n')
-					{
-						ln_lookup[++ln] = cur_ptr + 1;
-						col = 0;
-					}
-					else ++col;
-					++cur_ptr;
-				}
-				while (spaces.count(*cur_ptr))
-				{
-					if (*cur_ptr == '\n')
-					{
-						ln_lookup[++ln] = cur_ptr + 1;
-						col = 0;
-					}
-					else ++col;
-					++cur_ptr;
-				}
-				if (!p.no_attr)
-				{	// goto next token
-					return token(p.token_name, LN, COL, ln_lookup[LN], std::make_shared<attr_type>(m[0]));
-				}
-				else return token(p.token_name, LN, COL, ln_lookup[LN]);
-			}
+			ahead.insert(ahead.end(), at, c.end());
+			p = stop[i];
 		}
-		std::cerr << cur_ptr << std::endl;
+		else p = lex_until(p, begin[i + 1], ahead);		// it began inside a token such as a string
+	}
+	cur_ptr = p;		// the end or an invalid token, which next_token reports
+}
+
+int lexer_base::match_token(pchar& begin, pchar& end)
+{
+	int r_id = automaton.match(cur_ptr, src_end, end);
+	if (r_id < 0)
+	{
+		std::cerr << std::string(cur_ptr, src_end) << std::endl;
+		auto offset = cur_ptr - src;
 		cur_ptr = nullptr;
 		// input not valid
-		throw lex_err(ln, col, ln_lookup[ln]);
+		throw lex_err(offset);
 	}
-	return token();
+	begin = cur_ptr;
+	cur_ptr = dfa::skip_spaces(end, src_end);
+	return r_id;
+}
+
+token lexer_base::next_token()
+{
+	if (ahead_pos != ahead.size()) return ahead[ahead_pos++];
+	if (cur_ptr && cur_ptr != src_end)
+	{
+		pchar begin, end;
+		int r_id = match_token(begin, end);
+		return token(r_id, begin - src, end - begin);
+	}
+	return token(-1, (cur_ptr ? cur_ptr : src_end) - src, 0);		// located at the end
+}
+
+int lexer_base::rule_of(const std::string& token_name) const
+{
+	for (unsigned i = 0; i != rules_list.size(); ++i)
+		if (rules_list[i].token_name == token_name) return i;
+	return -1;
 }
 
 lexer::lexer(const init_rules& lex_R): lexer_base(lex_R.first)
+{
+	register_handlers(lex_R);
+}
+
+lexer::lexer(const init_rules& lex_R, const dfa::tables& T): lexer_base(lex_R.first, T)
+{
+	register_handlers(lex_R);
+}
+
+void lexer::register_handlers(const init_rules& lex_R)
 {	
+	std::map<std::string, handler> handler_lookup;
 	for (auto& v: lex_R.second)
 	{
 		handler_lookup[v.first] = v.second;
@@ -101,57 +146,47 @@ lexer::lexer(const init_rules& lex_R): lexer_base(lex_R.first)
 			std::cerr << "Using empty callback instead" << std::endl;*/
 			handler_lookup[v.token_name] = [](term_node&, AST_context*)->AST_result{ return AST_result(); };
 		}
+		handlers.push_back(handler_lookup[v.token_name]);
 	}
 }
 
-token lexer::next_token()
+const attr_type* lexer::attr_of(const token& t, pchar source)
 {
-	if (cur_ptr && *cur_ptr)
+	if (rules_list[t.kind].no_attr) return nullptr;
+	auto p = source + t.offset;
+	std::size_t h = 14695981039346656037ull ^ t.kind;
+	for (unsigned i = 0; i != t.length; ++i) h = (h ^ static_cast<unsigned char>(p[i])) * 1099511628211ull;
+	if (attrs.size() * 2 >= attr_slots.size()) rehash_attrs();
+	auto mask = attr_slots.size() - 1;
+	for (auto i = h & mask; ; i = (i + 1) & mask)
 	{
-		std::cmatch m;
-		int sz = rules_list.size();
-		for (int i = 0; i < sz; ++i)
-		{
-			auto& p = rules_list[i];
-			if (std::regex_search(cur_ptr, m, p.mode, std::regex_constants::match_continuous))
-			{	// this token has attr
-				unsigned LN = ln, COL = col;
-				while (cur_ptr != m.suffix().first)
-				{
-					if (*cur_ptr == '\n')
-					{
-						ln_lookup[++ln] = cur_ptr + 1;
-						col = 0;
-					}
-					else ++col;
-					++cur_ptr;
-				}
-				while (spaces.count(*cur_ptr))
-				{
-					if (*cur_ptr == '\n')
-					{
-						ln_lookup[++ln] = cur_ptr + 1;
-						col = 0;
-					}
-					else ++col;
-					++cur_ptr;
-				}
-				if (!p.no_attr)
-				{	// for the non-reserved tokens which need attrs
-					// goto next token
-					return token(p.token_name, LN, COL, ln_lookup[LN], std::make_shared<attr_type>(
-						m[0], handler_lookup[p.token_name]
-					));
-				}
-				else return token(p.token_name, LN, COL, ln_lookup[LN]);
-			}
+		auto& slot = attr_slots[i];
+		if (!slot.second)
+		{	// a new spelling
+			std::string value(p, t.length);
+			auto name = names.emplace(value, names.size()).first->second;
+			attrs.emplace_back(std::move(value), handlers[t.kind], t.kind, name);
+			slot = { h, &attrs.back() };
+			return slot.second;
 		}
-		std::cerr << cur_ptr << std::endl;
-		cur_ptr = nullptr;
-		// input not valid
-		throw lex_err(ln, col, ln_lookup[ln]);
+		auto a = slot.second;
+		if (slot.first == h && a->rule == t.kind && a->value.size() == t.length && !memcmp(a->value.data(), p, t.length))
+			return a;
+	}
+}
+
+void lexer::rehash_attrs()
+{
+	std::vector<std::pair<std::size_t, attr_type*>> slots(attr_slots.empty() ? 256 : attr_slots.size() * 2);
+	auto mask = slots.size() - 1;
+	for (auto& slot: attr_slots)
+	{
+		if (!slot.second) continue;
+		auto i = slot.first & mask;
+		while (slots[i].second) i = (i + 1) & mask;
+		slots[i] = slot;
 	}
-	return token();
+	attr_slots.swap(slots);
 }
 
 }
@@ -1,10 +1,13 @@
 #ifndef __LL_LEXER__HEADER_FILE
 #define __LL_LEXER__HEADER_FILE
-#include <regex>
 #include <set>
 #include <stack>
+#include <deque>
+#include <unordered_map>
 #include <functional>
+#include <thread>
 #include "utility.h"
+#include "dfa.h"
 
 namespace lr_parser
 {
@@ -13,12 +16,24 @@ namespace lr_parser
 	// no_attr : this token needs no attr so the lexer dont need to record default attrs.
 using reg_option = enum { word, no_attr, ignore_case };
 
-class lexer_base
+// tokens are pulled one at a time, a false token ends the input
+class token_source
 {
+public:
+	virtual ~token_source() = default;
+	virtual token next_token() = 0;
+	// the text of a token is a slice of it
+	virtual pchar source() const = 0;
+	virtual std::size_t source_size() const = 0;
+};
+
+class parser;
+class lexer_base: public token_source
+{
+	friend class parser;
 	struct rule
 	{
 		std::string token_name;
-		std::regex mode;
 		bool no_attr;
 	};
 public:
@@ -30,19 +45,46 @@ public:
 	using init_rules = std::vector<init_rule>;
 public:
 	lexer_base(const init_rules& iR);
+	// use a precompiled automaton
+	lexer_base(const init_rules& iR, const dfa::tables& T);
 	virtual ~lexer_base() = default;
-	void input(pchar p);
-	virtual token next_token();
-	std::map<unsigned, pchar> ln_lookup;
+	// scan the input in place, it must outlive the tokens, no '\0' is needed at its end
+	void input(pchar p, std::size_t n);
+	void input(pchar p)
+		{ input(p, strlen(p)); }
+	// lex the rest of the input in chunks on threads, next_token then returns the tokens
+	// a small input is left to be lexed one token at a time
+	void lex_ahead(unsigned threads);
+	// go on lexing from a token start of the input
+	void seek(unsigned offset)
+		{ cur_ptr = src + offset; ahead.clear(); ahead_pos = 0; }
+	virtual token next_token() override;
+	virtual pchar source() const override
+		{ return src; }
+	virtual std::size_t source_size() const override
+		{ return src_end - src; }
+	// the rule name and the matched text of a token from this lexer
+	const std::string& name_of(const token& t) const
+		{ return rules_list[t.kind].token_name; }
+	std::string text_of(const token& t) const
+		{ return std::string(src + t.offset, t.length); }
+	// the first rule of this name, -1 if none
+	int rule_of(const std::string& token_name) const;
+protected:
+	// match a token and move behind the spaces after it, returns the rule id
+	int match_token(pchar& begin, pchar& end);
+	// append the tokens starting before limit, returns where the next one or an invalid one starts
+	pchar lex_until(pchar p, pchar limit, std::vector<token>& tokens) const;
 protected:
-	std::string buffer;
+	pchar src = nullptr;
+	pchar src_end = nullptr;
 	pchar cur_ptr = nullptr;
+	std::vector<token> ahead;		// lexed by lex_ahead, cur_ptr is behind them
+	std::size_t ahead_pos = 0;
 	std::vector<rule> rules_list;
-	unsigned ln, col;
+	dfa automaton;
 };
 
-const std::set<char> spaces = { ' ', '\n', '\r', '\t' };
-
 class lexer: public lexer_base
 {
 public:
@@ -53,35 +95,48 @@ public:
 	using init_rules = std::pair<lexer_base::init_rules, helper_init_rules>;
 public:
 	lexer(const init_rules& h);
+	lexer(const init_rules& h, const dfa::tables& T);
 	virtual ~lexer() = default;
-	virtual token next_token() override;
+	// the attr of a token read from source, nullptr if its rule has none
+	// each spelling of a rule is stored once and lives as long as the lexer
+	const attr_type* attr_of(const token& t, pchar source);
+private:
+	void register_handlers(const init_rules& h);
+	void rehash_attrs();
 protected:
 	// no sub rules allowed
-	std::map<std::string, handler> handler_lookup;
+	std::vector<handler> handlers;		// [rule]
+	std::deque<attr_type> attrs;
+	std::vector<std::pair<std::size_t, attr_type*>> attr_slots;		// open addressing by hash
+	std::unordered_map<std::string, unsigned> names;		// a spelling of any rule -> its name
 };
 
 struct attr_type
 {	
 	std::string value;
 	lexer::handler func;
-	attr_type(std::string&& s = "", lexer::handler f = [](term_node&, AST_context*)->AST_result{}):
-		value(std::forward<std::string>(s)), func(f) {}
+	int rule;
+	unsigned name;		// the same for the same spelling of other rules
+	attr_type(std::string&& s = "", lexer::handler f = [](term_node&, AST_context*)->AST_result{}, int r = -1, unsigned n = 0):
+		value(std::forward<std::string>(s)), func(f), rule(r), name(n) {}
 };
 
 struct term_node: AST
 {
-	term_node(token& T): AST(T), data(T) {}
-	token data;
+	term_node(token& T, unsigned symbol, const attr_type* a): AST(T, symbol), attr(a) {}
+	const attr_type* attr;		// interned by the lexer
+	unsigned symbol() const
+		{ return id; }
 	virtual AST_result code_gen(AST_context* context) override
 	{	// handle a term
 		cur_node = this;
-		return data.attr->func(*this, context);
+		return attr->func(*this, context);
 	}
 };
 
 struct lex_err: err
 {
-	lex_err(unsigned p, unsigned t, pchar ptr): err("invalid token:", p, t, ptr)
+	lex_err(unsigned offset): err("invalid token:", offset)
 	{}
 	//void alert() const override
 };
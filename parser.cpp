@@ -1,10 +1,106 @@
 namespace lr_parser
 {
 // ctor
-parser::parser(lexer::init_rules& lR, init_rules& iR, expr_init_rules& eiR, const reinterpret_list& rL, std::string s):
+parser::parser(lexer::init_rules& lR, init_rules& iR, expr_init_rules& eiR, const reinterpret_list& rL, std::string s,
+		lookahead_option la):
 	lex(expr_gen(lR, iR, eiR)), rules({{s + "__", {s}}})
 {	// use a lexer to parse initializer rules
 	lexer_base::init_rules m_lR;
+	register_signs(lR, iR, rL, m_lR);
+	build_tables(iR, m_lR, s, la);
+	link_tables();
+}
+
+parser::parser(lexer::init_rules& lR, init_rules& iR, expr_init_rules& eiR, const reinterpret_list& rL,
+		const tables& T, std::string s, lookahead_option la):
+	packed(T.key == grammar_hash(lR, iR, eiR, rL, s, la) ? T :		// before expr_gen adds its rules
+		throw err("precompiled parser tables do not match the grammar, run wcgen again")),
+	lex(expr_gen(lR, iR, eiR), T.lexer)
+{
+	lexer_base::init_rules m_lR;
+	register_signs(lR, iR, rL, m_lR);
+	load_tables(iR, s);
+	link_tables();
+}
+
+parser::parser(lexer::init_rules& lR, init_rules& iR, expr_init_rules& eiR, const reinterpret_list& rL,
+		const table_cache& cache, std::string s, lookahead_option la):
+	parser(lR, iR, eiR, rL, open_cache(cache, lR, iR, eiR, rL, s, la), s, la)
+{
+}
+
+parser::parser(lexer::init_rules& lR, init_rules& iR, expr_init_rules& eiR, const reinterpret_list& rL,
+		const std::shared_ptr<const cached_tables>& c, const std::string& s, lookahead_option la):
+	parser(lR, iR, eiR, rL, c->T, s, la)
+{
+	cached = c;
+}
+
+std::uint64_t parser::grammar_hash(const lexer::init_rules& lR, const init_rules& iR, const expr_init_rules& eiR,
+		const reinterpret_list& rL, const std::string& s, lookahead_option la)
+{	// fnv-1a over every string of the rules
+	std::uint64_t h = 14695981039346656037ull;
+	auto add = [&](const std::string& str)
+	{
+		for (unsigned char c: str) h = (h ^ c) * 1099511628211ull;
+		h = (h ^ 0xff) * 1099511628211ull;		// separator, no rule string contains it
+	};
+	auto add_int = [&](int n) { add(std::to_string(n)); };
+	add("wc tables 4");
+	add(s);
+	add_int(la);
+	for (auto& r: lR.first)
+	{
+		add(r.token_name); add(r.mode);
+		for (auto opt: r.opts) add_int(opt);
+	}
+	for (auto& r: iR)
+	{
+		add(r.first);
+		for (auto& g: r.second)
+		{
+			add(g.first);
+			for (auto& call_back: g.on_match) add_int(call_back.first);
+		}
+	}
+	for (auto& level: eiR)
+	{
+		add_int(level.size());
+		for (auto& op: level) { add(op.mode_str); add_int(op.asl); }
+	}
+	for (auto& v: rL)
+	{
+		add(v.first);
+		for (auto& dest: v.second) { add_int(dest.stype); add(dest.target); }
+	}
+	return h;
+}
+
+std::shared_ptr<const parser::cached_tables> parser::open_cache(const table_cache& cache, lexer::init_rules lR,
+		init_rules iR, expr_init_rules eiR, const reinterpret_list& rL, const std::string& s, lookahead_option la)
+{
+	auto key = grammar_hash(lR, iR, eiR, rL, s, la);
+	char name[20];
+	sprintf(name, "%016llx", static_cast<unsigned long long>(key));
+	auto path = cache.dir + "/" + name + ".wct";
+	auto res = std::make_shared<cached_tables>();
+	if (res->file.open(path) && table_image::view_binary(res->file.data(), res->file.size(), key, res->T))
+		return res;
+	// miss, generate from copies of the rules and save them
+	parser(lR, iR, eiR, rL, s, la).export_tables(res->image);
+	res->image.key = key;
+	std::ostringstream os;
+	res->image.write_binary(os, key);
+	if (write_file_atomic(path, os.str()) && res->file.open(path) &&
+		table_image::view_binary(res->file.data(), res->file.size(), key, res->T))
+		return res;
+	res->file.close();
+	res->T = res->image.view();
+	return res;
+}
+
+void parser::register_signs(lexer::init_rules& lR, init_rules& iR, const reinterpret_list& rL, lexer_base::init_rules& m_lR)
+{
 	for (auto& r: lR.first)
 	{
 		if (r.opts.count(no_attr))
@@ -45,284 +141,909 @@ parser::parser(lexer::init_rules& lR, init_rules& iR, expr_init_rules& eiR, cons
 	}
 	signs.insert(stack_bottom);	// stack empty
 	signs.insert(empty_sign);
+}
+
+void parser::build_tables(init_rules& iR, lexer_base::init_rules& m_lR, const std::string& s, lookahead_option la)
+{
 	lexer_base m_lexer(m_lR);
-	std::map<sign, std::set<rule_id>> rules_map;
 	for (auto& p: iR)
 	{
 		for (auto& g: p.second)
 		{
-			rule r = { p.first, {}, 0, g.second, g.on_match };	// if second == {} then it is empty
+			rule r = { p.first, {}, 0, g.second, g.on_match, g.list };	// if second == {} then it is empty
 			m_lexer.input(g.first.c_str());
 			token T;
 			while (T = m_lexer.next_token())
 			{	// record all sub rules
-				r.signs.push_back(T.name);
-				if (terms.count(T.name) || gens.count(T.name)) ++r.sub_count;
+				auto& name = m_lexer.name_of(T);
+				r.signs.push_back(name);
+				if (terms.count(name) || gens.count(name)) ++r.sub_count;
 			}
 			if (r.signs.empty())
 			{
 				r.signs.push_back(empty_sign);
 			}
-			rules_map[p.first].insert(rules.size());
 			rules.push_back(r);
 		}
 	}
-	
-	// Generate FIRST<> && FOLLOW<>
-	std::map<sign, std::set<sign>> FIRST, FOLLOW;
+
+	// intern the signs, S__ comes last
+	std::vector<sign> names(signs.begin(), signs.end());
+	names.push_back(rules[0].src);
+	std::map<sign, symbol> ids;
+	for (symbol i = 0; i != names.size(); ++i) ids[names[i]] = i;
+	int sign_count = names.size();
+	symbol start = ids.at(rules[0].src), empty = ids.at(empty_sign), bottom = ids.at(stack_bottom);
+	std::vector<symbol> lhs;
+	std::vector<std::vector<symbol>> rhs;
+	std::vector<std::vector<rule_id>> rules_of(sign_count);
+	for (rule_id i = 0; i != rules.size(); ++i)
+	{
+		lhs.push_back(ids.at(rules[i].src));
+		rhs.emplace_back();
+		for (auto& sgn: rules[i].signs) rhs.back().push_back(ids.at(sgn));
+		if (i) rules_of[lhs.back()].push_back(i);
+	}
+	auto is_gen = [&](symbol sym) { return !rules_of[sym].empty(); };
+	auto is_empty_rule = [&](rule_id r) { return rhs[r].size() == 1 && rhs[r][0] == empty; };
+	auto unit_rule = [&](rule_id r) { return rules[r].signs.size() == 1 && unit_rules.count({ rules[r].src, rules[r].signs[0] }); };
+
+	// Generate FIRST<> && FOLLOW<> over symbol bitsets
+	int words = (sign_count + 63) / 64;
+	auto has = [](const symbol_set& a, symbol sym) { return (a[sym >> 6] >> (sym & 63)) & 1; };
+	auto add = [](symbol_set& a, symbol sym) { a[sym >> 6] |= std::uint64_t(1) << (sym & 63); };
+	auto merge_into = [&](symbol_set& dst, const symbol_set& src, bool keep_empty)
+	{	// returns true if dst grows
+		bool grow = false;
+		for (int w = 0; w != words; ++w)
+		{
+			auto bits = src[w];
+			if (!keep_empty && w == (empty >> 6)) bits &= ~(std::uint64_t(1) << (empty & 63));
+			grow |= (dst[w] | bits) != dst[w];
+			dst[w] |= bits;
+		}
+		return grow;
+	};
+	std::vector<symbol_set> FIRST(sign_count, symbol_set(words)), FOLLOW(sign_count, symbol_set(words));
+	for (symbol sym = 0; sym != sign_count; ++sym)
+		if (!is_gen(sym) && sym != start) add(FIRST[sym], sym);
 	bool add_sub = false;
 	do {
 		add_sub = false;
-		for (auto& sgn: signs)
+		for (symbol sym = 0; sym != sign_count; ++sym)
 		{
-			if (!rules_map[sgn].empty())	// is gen
-			{	//gen_first(sgn);
-				for (auto r_id: rules_map[sgn])
+			for (auto r_id: rules_of[sym])
+			{
+				bool has_empty = false;
+				for (auto t: rhs[r_id])
 				{
-					bool has_empty;
-					for (auto& t: rules[r_id].signs)
-					{
-						has_empty = false;
-						for (auto& g: FIRST[t])
-						{
-							if (g == empty_sign)
-							{
-								has_empty = true;
-							}
-							else if (!FIRST[sgn].count(g))
-							{
-								FIRST[sgn].insert(g);
-								add_sub = true;
-							}
-						}
-						if (!has_empty) break;
-					}
-					if (has_empty && !FIRST[sgn].count(empty_sign))
-					{
-						FIRST[sgn].insert(empty_sign);
-						add_sub = true;
-					}
+					add_sub |= merge_into(FIRST[sym], FIRST[t], false);
+					has_empty = has(FIRST[t], empty);
+					if (!has_empty) break;
+				}
+				if (has_empty && !has(FIRST[sym], empty))
+				{
+					add(FIRST[sym], empty);
+					add_sub = true;
 				}
-			}
-			else if (!FIRST[sgn].count(sgn))
-			{
-				FIRST[sgn] = { sgn };
-				add_sub = true;
 			}
 		}
 	} while (add_sub);
 	do {
 		add_sub = false;
-		for (auto& r: rules)
+		for (rule_id r = 0; r != rules.size(); ++r)
 		{	// for all the gen rules
-			for (int i = r.signs.size() - 1; i > 0; --i)
+			auto& R = rhs[r];
+			for (int i = R.size() - 1; i > 0; --i)
 			{	// A -> aBb
-				if (!rules_map[r.signs[i - 1]].empty())
-				{	// B
-					if (!rules_map[r.signs[i]].empty())
-					{	// b
-						for (auto& sgn: FIRST[r.signs[i]])
-						{
-							if (sgn != empty_sign && !FOLLOW[r.signs[i - 1]].count(sgn))
-							{
-								FOLLOW[r.signs[i - 1]].insert(sgn);
-								add_sub = true;
-							}
-						}
-						if (FIRST[r.signs[i]].count(empty_sign))
-						{
-							for (auto& sgn: FOLLOW[r.src])
-							{
-								if (!FOLLOW[r.signs[i - 1]].count(sgn))
-								{
-									FOLLOW[r.signs[i - 1]].insert(sgn);
-									add_sub = true;
-								}
-							}
-						}
-					}
-					else
-					{
-						if (!FOLLOW[r.signs[i - 1]].count(r.signs[i]))
-						{
-							FOLLOW[r.signs[i - 1]].insert(r.signs[i]);
-							add_sub = true;
-						}
-					}
+				if (!is_gen(R[i - 1])) continue;
+				if (is_gen(R[i]))
+				{	// b
+					add_sub |= merge_into(FOLLOW[R[i - 1]], FIRST[R[i]], false);
+					if (has(FIRST[R[i]], empty)) add_sub |= merge_into(FOLLOW[R[i - 1]], FOLLOW[lhs[r]], true);
 				}
-			}
-			if (!rules_map[r.signs.back()].empty())
-			{
-				for (auto& sgn: FOLLOW[r.src])
+				else if (!has(FOLLOW[R[i - 1]], R[i]))
 				{
-					if (!FOLLOW[r.signs.back()].count(sgn))
-					{
-						FOLLOW[r.signs.back()].insert(sgn);
-						add_sub = true;
-					}
+					add(FOLLOW[R[i - 1]], R[i]);
+					add_sub = true;
 				}
 			}
+			if (is_gen(R.back())) add_sub |= merge_into(FOLLOW[R.back()], FOLLOW[lhs[r]], true);
 		}
 	} while (add_sub);
-	for (auto& sgn: signs)
+	for (symbol sym = 0; sym != sign_count; ++sym)
+		if (is_gen(sym)) add(FOLLOW[sym], bottom);
+	add(FOLLOW[start], bottom);
+
+	// LR(0) automaton, states are numbered in the order they are found and
+	// a kernel is looked up by hash, so each goto set is built once
+	struct kernel_hash
 	{
-		if (!rules_map[sgn].empty())
+		std::size_t operator () (const kernel& k) const
 		{
-			FOLLOW[sgn].insert(stack_bottom);
+			std::size_t h = k.size();
+			for (auto& v: k) h = (h * 31 + v.first) * 31 + v.second;
+			return h;
 		}
-	}
-	FOLLOW[s + "__"].insert(stack_bottom);
-
-
-	std::vector<closure> closures;	// S__ -> S
-	auto GEN = [&](closure I)
+	};
+	std::unordered_map<kernel, state, kernel_hash> kernel_state;
+	std::vector<kernel> closures;	// S__ -> S
+	std::vector<std::vector<action>> ACTION;		// [state][symbol]->action->rule_id
+	std::vector<std::vector<state>> GOTO;			// [state][symbol]->state
+	std::map<state, std::pair<rule_id, int>> callback_item;		// rule_id, index of on_match
+	std::vector<char> in_closure(rules.size());
+	auto GEN = [&](const kernel& K)
 	{
-		bool gen_sub = false;
-		do {
-			gen_sub = false;
-			for (auto& T: I)
+		state id = closures.size();
+		kernel_state.insert({ K, id });
+		kernel I = K;
+		for (auto& v: I) if (!v.second) in_closure[v.first] = 1;
+		for (int k = 0; k != I.size(); ++k)
+		{	// items after the kernel are {rule_id, 0}
+			auto& R = rhs[I[k].first];
+			if (I[k].second != R.size())
 			{
-				if (rules[T.first].signs.size() != T.second)
-				{
-					for (auto r_id: rules_map[rules[T.first].signs[T.second]])
-					{	// all rules from this sign
-						if (!I.count({r_id, 0}))
-						{
-							I.insert({r_id, 0});
-							gen_sub = true;
-						}
+				for (auto r_id: rules_of[R[I[k].second]])
+				{	// all rules from this sign
+					if (!in_closure[r_id])
+					{
+						in_closure[r_id] = 1;
+						I.push_back({ r_id, 0 });
 					}
-				}// else this is mergeable 
+				}
 			}
-		} while (gen_sub);
+		}
+		for (auto& v: I) if (!v.second) in_closure[v.first] = 0;
+		std::sort(I.begin(), I.end());
 		for (auto& v: I)		// foreach item in I
 		{
-			for (auto& call_back: rules[v.first].on_match)
+			auto& on_match = rules[v.first].on_match;
+			for (int k = 0; k != on_match.size(); ++k)
 			{
-				if (call_back.first == v.second)
-					if (!matching_callback_map[closures.size()])
+				if (on_match[k].first == v.second)
+					if (!callback_item.count(id))
 				{
-					matching_callback_map[closures.size()] = call_back.second;
+					callback_item[id] = { v.first, k };
 				}
 				else throw err("cannot initialize parser because 'callback for matching state conflicted'");
 			}
 		}
 		closures.push_back(std::move(I));
-		GOTO.push_back(std::map<sign, state>());
-		ACTION.push_back(std::map<sign, action>());
+		GOTO.emplace_back(sign_count);
+		ACTION.emplace_back(sign_count);
+		return id;
 	};
 	GEN({{0, 0}});
-	auto show = [&](int i)
-	{
-		std ::cout << ">>> " << i << std::endl;
+	std::vector<std::pair<state, symbol>> found_by = { { -1, -1 } };		// [state] the goto that generated it
+	std::vector<kernel> NEW(sign_count);
+	for (state i = 0; i < closures.size(); ++i)
+	{	// i stands for state, a worklist of the states not visited yet
 		for (auto& T: closures[i])
+		{	// for each term in this closure T = {rule_id, pos}
+			if (T.second != rhs[T.first].size())
+				NEW[rhs[T.first][T.second]].push_back({ T.first, T.second + 1 });
+		}
+		for (symbol sym = 0; sym != sign_count; ++sym)
 		{
-			std::cout << rules[T.first].src<< " -> ";
-			int i = 0;
-			for (auto& v: rules[T.first].signs)
+			if (NEW[sym].empty()) continue;
+			auto itr = kernel_state.find(NEW[sym]);
+			if (itr != kernel_state.end()) GOTO[i][sym] = itr->second;
+			else
 			{
-				if (i == T.second) std::cout << ".";
-				std::cout << v + " ";
-				++i;
-			} 
-			if (i == T.second) std::cout << ".";
-			std::cout << std::endl;
+				auto j = GEN(NEW[sym]); // generate this closure
+				GOTO[i][sym] = j;
+				found_by.push_back({ i, sym });
+			}
+			NEW[sym].clear();
 		}
+	}
+
+	// lookaheads of the reductions, [state][rule_id] for lalr
+	std::vector<std::map<rule_id, symbol_set>> LA;
+	if (la == lalr_lookahead) LA = lalr_lookaheads(closures, GOTO, lhs, rhs, FIRST, empty, bottom);
+	auto lookahead = [&](state i, rule_id r)->const symbol_set&
+	{
+		return la == lalr_lookahead ? LA[i][r] : FOLLOW[lhs[r]];
 	};
-	auto alert = [&]()
+	std::string conflict = la == lalr_lookahead ? "Not LALR(1) at " : "Not SLR at ";
+	for (state i = 0; i != closures.size(); ++i)
 	{
-		for (int i = 0; i < closures.size(); ++i)
+		int has_empty_sign = 0;
+		for (auto& T: closures[i])
 		{
-			show(i);
-			/*for (auto& sgn: signs)
+			if (is_empty_rule(T.first))
 			{
-				std::cout << "ACTION[" << i << "][" << sgn << "]" << ACTION[i][sgn] << std::endl;
-				std::cout << "GOTO[" << i << "][" << sgn << "]" << GOTO[i][sgn] << std::endl;
-			}*/
+				has_empty_sign = T.first;
+			}
+			else if (rhs[T.first].size() == T.second)
+			{	// this item ends
+				auto& follow = lookahead(i, T.first);
+				for (symbol sym = 0; sym != sign_count; ++sym)
+					if (has(follow, sym)) ACTION[i][sym] = T.first == 0 ? a_accept: T.first;	// S__ -> S
+			}
 		}
-	};
-	closure NEW;
-	do {
-		for (int i = 0; i < closures.size(); ++i)
-		{	// i stands for state
-			int has_empty_sign = 0;
-			for (auto& T: closures[i])
-			{
-				if (rules[T.first].signs.size() == 1 && rules[T.first].signs[0] == empty_sign)
+		for (symbol sym = 0; sym != sign_count; ++sym)
+		{
+			auto j = GOTO[i][sym];
+			if (!j) continue;
+			if (found_by[j] != std::make_pair(i, sym)) ACTION[i][sym] = a_move_in;
+			else
+			{	// conflicts are only checked where the goto found a new state
+				int r_id = 0;
+				for (auto& T: closures[j]) if (T.second) { r_id = T.first; break; }
+				auto& act = ACTION[i][sym];
+				switch (act)			// ambigious
 				{
-					has_empty_sign = T.first;
-				}
-				else if (rules[T.first].signs.size() == T.second)
-				{	// this item ends
-					for (auto& sgn: FOLLOW[rules[T.first].src])
-					{
-						ACTION[i][sgn] = T.first == 0 ? a_accept: T.first;	// S__ -> S
-					}
+				case a_move_in: throw parser_err(conflict + names[sym]);
+				default: if (r_id < act) act = a_move_in; break;
+				case a_error: act = a_move_in; break;
+				case a_accept: throw parser_err(conflict + names[sym]);
 				}
 			}
-			for (auto& sgn: signs)
+		}
+		if (has_empty_sign)
+		{	// an empty rule reduces where nothing else is done
+			for (symbol sym = 0; sym != sign_count; ++sym)
+			{
+				if (sym != start && !ACTION[i][sym] && (la != lalr_lookahead || has(LA[i][has_empty_sign], sym)))
+					ACTION[i][sym] = has_empty_sign;	// S__ -> S
+			}
+		}
+	}
+
+	// a state that only reduces a unit rule of the expression levels is skipped,
+	// the goto into it goes where the reduction would go
+	std::vector<rule_id> skip(closures.size());
+	for (state j = 0; j != closures.size(); ++j)
+	{
+		auto& I = closures[j];
+		if (I.size() == 1 && I[0].second == 1 && unit_rule(I[0].first) && !callback_item.count(j))
+			skip[j] = I[0].first;
+	}
+	for (state i = 0; i != closures.size(); ++i)
+	{
+		for (symbol sym = 0; sym != sign_count; ++sym)
+		{
+			auto& j = GOTO[i][sym];
+			while (j && skip[j]) j = GOTO[i][lhs[skip[j]]];
+		}
+	}
+	// where a unit reduction goes on depends on the state below it, so a state that
+	// reduces one is copied for each state that goes to it, see the chains composed below
+	auto unit_action = [&](action act) { return act > 0 && unit_rule(act); };
+	std::vector<int> goes_to(closures.size());
+	for (state i = 0; i != closures.size(); ++i)
+		for (auto j: GOTO[i]) if (j) ++goes_to[j];
+	std::map<std::pair<state, state>, state> copy_of;
+	for (state i = 0; i != closures.size(); ++i)
+	{
+		for (symbol sym = 0; sym != sign_count; ++sym)
+		{
+			auto j = GOTO[i][sym];
+			if (!j || goes_to[j] < 2 || !std::any_of(ACTION[j].begin(), ACTION[j].end(), unit_action)) continue;
+			auto itr = copy_of.find({ i, j });
+			if (itr == copy_of.end())
+			{
+				itr = copy_of.insert({ { i, j }, ACTION.size() }).first;
+				ACTION.push_back(ACTION[j]);
+				GOTO.push_back(GOTO[j]);
+				if (callback_item.count(j)) callback_item[itr->second] = callback_item[j];
+			}
+			GOTO[i][sym] = itr->second;
+		}
+	}
+	// drop the states nothing goes to any more
+	std::vector<state> renum(GOTO.size(), -1), order = { 0 };
+	renum[0] = 0;
+	for (int k = 0; k != order.size(); ++k)
+		for (auto j: GOTO[order[k]])
+			if (j && renum[j] < 0) { renum[j] = order.size(); order.push_back(j); }
+	if (order.size() != GOTO.size())
+	{
+		std::sort(order.begin(), order.end());		// keep the order states were found in
+		for (state k = 0; k != order.size(); ++k) renum[order[k]] = k;
+		std::vector<std::vector<action>> A;
+		std::vector<std::vector<state>> G;
+		std::map<state, std::pair<rule_id, int>> C;
+		for (auto j: order)
+		{
+			A.push_back(std::move(ACTION[j]));
+			G.push_back(std::move(GOTO[j]));
+			for (auto& t: G.back()) if (t) t = renum[t];
+			if (callback_item.count(j)) C[renum[j]] = callback_item[j];
+		}
+		ACTION.swap(A);
+		GOTO.swap(G);
+		callback_item.swap(C);
+	}
+	// a unit reduction is followed by the next one on the same lookahead in the state the goto
+	// leads to, until a state does something else. where the chain ends at the same level for
+	// every state below, the first reduction goes there at once by a rule of the composed units
+	std::vector<std::vector<state>> preds(GOTO.size());
+	for (state p = 0; p != GOTO.size(); ++p)
+		for (auto j: GOTO[p])
+			if (j && (preds[j].empty() || preds[j].back() != p)) preds[j].push_back(p);
+	std::map<std::pair<symbol, symbol>, rule_id> composed;
+	for (state i = 0; i != ACTION.size(); ++i)
+	{
+		for (symbol sym = 0; sym != sign_count; ++sym)
+		{
+			auto r = ACTION[i][sym];
+			if (!unit_action(r) || preds[i].empty()) continue;
+			symbol end = -1;
+			bool same = true;
+			for (auto p: preds[i])
+			{
+				symbol A = lhs[r];
+				for (state j; (j = GOTO[p][A]) && !callback_item.count(j) && unit_action(ACTION[j][sym]); )
+					A = lhs[ACTION[j][sym]];
+				same = same && (end < 0 || end == A);
+				end = A;
+			}
+			if (!same || end == lhs[r]) continue;
+			auto& id = composed[{ end, rhs[r][0] }];
+			if (!id)
+			{
+				id = rules.size();
+				auto below = rules[r].signs;
+				rules.push_back({ names[end], below, 1, nullptr, {}, false });
+				unit_rules.insert({ names[end], below[0] });
+				lhs.push_back(end);
+				rhs.push_back(rhs[r]);
+			}
+			ACTION[i][sym] = id;
+		}
+	}
+	pack_tables(names, ACTION, GOTO, callback_item);
+}
+
+// DeRemer and Pennello, Efficient Computation of LALR(1) Look-Ahead Sets
+std::vector<std::map<parser::rule_id, parser::symbol_set>> parser::lalr_lookaheads(const std::vector<kernel>& closures,
+		const std::vector<std::vector<state>>& GOTO, const std::vector<symbol>& lhs, const std::vector<std::vector<symbol>>& rhs,
+		const std::vector<symbol_set>& FIRST, symbol empty, symbol bottom)
+{
+	int sign_count = FIRST.size(), words = (sign_count + 63) / 64;
+	auto has = [](const symbol_set& a, symbol sym) { return (a[sym >> 6] >> (sym & 63)) & 1; };
+	auto add = [](symbol_set& a, symbol sym) { a[sym >> 6] |= std::uint64_t(1) << (sym & 63); };
+	std::vector<std::vector<rule_id>> rules_of(sign_count);
+	for (rule_id r = 1; r < lhs.size(); ++r) rules_of[lhs[r]].push_back(r);
+	auto is_gen = [&](symbol sym) { return !rules_of[sym].empty(); };
+	auto nullable = [&](symbol sym) { return has(FIRST[sym], empty); };
+	auto length = [&](rule_id r) { return rhs[r].size() == 1 && rhs[r][0] == empty ? 0 : rhs[r].size(); };
+
+	// nonterminal transitions
+	std::map<std::pair<state, symbol>, int> trans_id;
+	std::vector<std::pair<state, symbol>> trans;
+	for (state p = 0; p != GOTO.size(); ++p)
+		for (symbol A = 0; A != sign_count; ++A)
+			if (is_gen(A) && GOTO[p][A])
+			{
+				trans_id[{ p, A }] = trans.size();
+				trans.push_back({ p, A });
+			}
+	int n = trans.size();
+	// direct reads, and reads through nullable transitions
+	std::vector<symbol_set> F(n, symbol_set(words));
+	std::vector<std::vector<int>> reads(n), includes(n);
+	for (int x = 0; x != n; ++x)
+	{
+		auto r = GOTO[trans[x].first][trans[x].second];
+		for (symbol t = 0; t != sign_count; ++t)
+		{
+			if (!GOTO[r][t] || t == empty) continue;
+			if (!is_gen(t)) add(F[x], t);
+			else if (nullable(t)) reads[x].push_back(trans_id.at({ r, t }));
+		}
+		if (std::binary_search(closures[r].begin(), closures[r].end(), item(0, 1)))
+			add(F[x], bottom);		// S__ -> S. is followed by the end of input
+	}
+	// includes and lookback, walk each rule from each transition on its left side
+	std::vector<std::map<rule_id, std::vector<int>>> lookback(GOTO.size());
+	for (int x = 0; x != n; ++x)
+	{
+		for (auto r: rules_of[trans[x].second])
+		{
+			state st = trans[x].first;
+			int len = length(r);
+			for (int k = 0; k != len; ++k)
 			{
-				NEW = {};
-				if (!GOTO[i][sgn])
+				auto X = rhs[r][k];
+				if (is_gen(X))
 				{
-					for (auto& T: closures[i])
-					{	// for each term in this closure T = {rule_id, pos}
-						if (T.second != rules[T.first].signs.size() &&
-							rules[T.first].signs[T.second] == sgn)
-						{	// check if this sgn matches this rule    pass or 
-							NEW.insert({T.first, T.second + 1});
-						}
-					}
-					if (!NEW.empty())
-					{
-						bool is_sub;
-						int j = 0, r_id = 0x7FFFFFFF;
-						for (; j < closures.size(); ++j)
-						{	// TODO: is this right?
-							is_sub = true;
-							for (auto& T: NEW)
-							{
-								r_id = std::min(T.first, r_id);
-								if (!closures[j].count(T))
-								{
-									is_sub = false;
-									break;
-								}
-							}
-							if (is_sub) break;
-						}
-						if (is_sub)
-						{
-							GOTO[i][sgn] = j;
-							ACTION[i][sgn] = a_move_in;
-						}
-						else 
-						{
-							GOTO[i][sgn] = closures.size();
-							//std::cout << sgn << std::endl;
-							GEN(NEW); // generate this closure
-							//if (ACTION[i][sgn] != 0) std::cerr << sgn << " " << ACTION[i][sgn] << " " << r_id << std::endl;
-							switch (ACTION[i][sgn])			// ambigious
-							{
-							case a_move_in: throw parser_err("Not SLR at " + sgn);
-							default: if (r_id < ACTION[i][sgn]) ACTION[i][sgn] = a_move_in; break;
-							case a_error: ACTION[i][sgn] = a_move_in; break;
-							case a_accept: throw parser_err("Not SLR at " + sgn);
-							}
-						}
-					}
+					bool rest_nullable = true;
+					for (int m = k + 1; m < len && rest_nullable; ++m)
+						rest_nullable = is_gen(rhs[r][m]) && nullable(rhs[r][m]);
+					if (rest_nullable) includes[trans_id.at({ st, X })].push_back(x);
 				}
+				st = GOTO[st][X];
+			}
+			lookback[st][r].push_back(x);
+		}
+	}
+	// F(x) = F'(x) + all F(y) with x R y, strongly connected parts share one set
+	auto digraph = [&](const std::vector<std::vector<int>>& R)
+	{
+		std::vector<int> N(n), stack;
+		std::function<void(int)> traverse = [&](int x)
+		{
+			stack.push_back(x);
+			int d = stack.size();
+			N[x] = d;
+			for (auto y: R[x])
+			{
+				if (!N[y]) traverse(y);
+				N[x] = std::min(N[x], N[y]);
+				for (int w = 0; w != words; ++w) F[x][w] |= F[y][w];
+			}
+			if (N[x] == d)
+			{
+				int z;
+				do {
+					z = stack.back(); stack.pop_back();
+					N[z] = 0x7FFFFFFF;
+					F[z] = F[x];
+				} while (z != x);
+			}
+		};
+		for (int x = 0; x != n; ++x) if (!N[x]) traverse(x);
+	};
+	digraph(reads);		// Read
+	digraph(includes);	// Follow
+
+	std::vector<std::map<rule_id, symbol_set>> LA(closures.size());
+	for (state q = 0; q != closures.size(); ++q)
+	{
+		for (auto& T: closures[q])
+		{	// every reduction gets a set, empty ones included
+			if (T.second == rhs[T.first].size() || !length(T.first))
+				LA[q][T.first].resize(words);
+		}
+		for (auto& lb: lookback[q])
+			for (auto x: lb.second)
+				for (int w = 0; w != words; ++w) LA[q][lb.first][w] |= F[x][w];
+		if (std::binary_search(closures[q].begin(), closures[q].end(), item(0, 1)))
+			add(LA[q][0], bottom);
+	}
+	return LA;
+}
+
+void parser::pack_tables(const std::vector<sign>& names, const std::vector<std::vector<action>>& ACTION,
+		const std::vector<std::vector<state>>& GOTO, const std::map<state, std::pair<rule_id, int>>& callback_item)
+{
+	auto& image = table_storage;
+	image = table_image();
+	// a symbol is the order of its name in the pool
+	std::map<sign, symbol> ids;
+	for (auto& sgn: names)
+	{
+		ids[sgn] = image.sign_offset.size();
+		image.sign_offset.push_back(image.sign_pool.size());
+		image.sign_pool += sgn;
+		image.sign_pool.push_back('\0');
+	}
+	for (auto& r: rules)
+	{
+		image.rule_src.push_back(ids.at(r.src));
+		image.rule_sign_begin.push_back(image.rule_signs.size());
+		for (auto& sgn: r.signs) image.rule_signs.push_back(ids.at(sgn));
+		image.rule_sub_count.push_back(r.sub_count);
+	}
+	image.rule_sign_begin.push_back(image.rule_signs.size());
+
+	// a row keeps the entries that differ from the default of its state
+	int state_count = ACTION.size(), sign_count = names.size();
+	using row_type = std::vector<std::pair<symbol, int>>;
+	std::vector<row_type> rows(state_count * 2);
+	for (state i = 0; i != state_count; ++i)
+	{
+		std::map<action, int> freq;
+		for (auto act: ACTION[i]) ++freq[act];
+		action def = a_error;
+		int best = 0;
+		for (auto& f: freq) if (f.second > best) { def = f.first; best = f.second; }
+		image.action_default.push_back(def);
+		for (symbol sym = 0; sym != sign_count; ++sym)
+		{
+			if (ACTION[i][sym] != def) rows[i].push_back({ sym, ACTION[i][sym] });
+			if (GOTO[i][sym]) rows[state_count + i].push_back({ sym, GOTO[i][sym] });
+		}
+	}
+	// first fit the rows into one comb vector, the longest first
+	// a slot is checked against the base of its row, so equal rows share their base
+	std::map<row_type, int> row_base;
+	for (auto& row: rows) row_base.insert({ row, -1 });
+	std::vector<const row_type*> order;
+	for (auto& r: row_base) order.push_back(&r.first);
+	std::stable_sort(order.begin(), order.end(), [](const row_type* a, const row_type* b) { return a->size() > b->size(); });
+	auto& check = image.comb_check;
+	auto& value = image.comb_value;
+	std::vector<char> used_base;
+	int first_free = 0, words = (sign_count + 63) / 64;
+	std::vector<std::uint64_t> occupied, mask(words);		// slots in use, symbols of a row
+	auto occupied_at = [&](int pos)
+	{	// 64 slots from pos
+		unsigned w = pos >> 6, sh = pos & 63;
+		auto lo = w < occupied.size() ? occupied[w] >> sh : 0;
+		auto hi = sh && w + 1 < occupied.size() ? occupied[w + 1] << (64 - sh) : 0;
+		return lo | hi;
+	};
+	for (auto row: order)
+	{
+		int b = 0;
+		if (!row->empty())
+		{
+			std::fill(mask.begin(), mask.end(), 0);
+			for (auto& e: *row) mask[e.first >> 6] |= std::uint64_t(1) << (e.first & 63);
+			for (b = std::max(first_free - row->front().first, 0);; ++b)
+			{
+				bool fit = b >= used_base.size() || !used_base[b];
+				for (int w = 0; fit && w != words; ++w) fit = !(occupied_at(b + w * 64) & mask[w]);
+				if (fit) break;
 			}
-			if (has_empty_sign)
+			for (auto& e: *row)
 			{
-				for (auto& sgn: signs)
+				if (b + e.first >= check.size())
 				{
-					if (!ACTION[i][sgn]) ACTION[i][sgn] = has_empty_sign;	// S__ -> S
+					check.resize(b + e.first + 1, -1);
+					value.resize(b + e.first + 1, 0);
+					occupied.resize(check.size() / 64 + 1);
 				}
+				check[b + e.first] = b;
+				value[b + e.first] = e.second;
+				occupied[(b + e.first) >> 6] |= std::uint64_t(1) << ((b + e.first) & 63);
+			}
+			while (first_free < check.size() && check[first_free] >= 0) ++first_free;
+		}
+		else while (b < used_base.size() && used_base[b]) ++b;		// no slot is checked against an unused base
+		if (b >= used_base.size()) used_base.resize(b + 1);
+		used_base[b] = 1;
+		row_base[*row] = b;
+	}
+	// any base + symbol stays in the vector
+	check.resize(std::max<int>(check.size(), used_base.size()) + sign_count, -1);
+	value.resize(check.size(), 0);
+	std::vector<int> base;
+	for (auto& row: rows) base.push_back(row_base[row]);
+	image.action_base.assign(base.begin(), base.begin() + state_count);
+	image.goto_base.assign(base.begin() + state_count, base.end());
+	for (auto& c: callback_item)
+	{
+		image.callback_items.push_back(c.first);
+		image.callback_items.push_back(c.second.first);
+		image.callback_items.push_back(c.second.second);
+	}
+	packed = image.view();
+	packed.lexer = lex.automaton.get_tables();
+}
+
+void parser::load_tables(init_rules& iR, const std::string& s)
+{
+	auto& T = packed;
+	auto name = [&](int sgn) { return std::string(T.sign_pool + T.sign_offset[sgn]); };
+	auto verify = [](bool ok) {
+		if (!ok) throw err("precompiled parser tables do not match the grammar, run wcgen again");
+	};
+	std::set<sign> names;
+	for (int i = 0; i != T.sign_count; ++i) names.insert(name(i));
+	for (auto& sgn: signs) verify(names.count(sgn));
+	// rules are numbered as the ctor reads them
+	std::vector<std::pair<std::string, const init_rule_item*>> items = { { s + "__", nullptr } };
+	for (auto& p: iR)
+		for (auto& g: p.second) items.push_back({ p.first, &g });
+	verify(T.rule_count >= items.size());
+	for (int i = 0; i != T.rule_count; ++i)
+	{
+		rule r = { name(T.rule_src[i]), {}, T.rule_sub_count[i], nullptr, {}, false };
+		for (int j = T.rule_sign_begin[i]; j != T.rule_sign_begin[i + 1]; ++j)
+			r.signs.push_back(name(T.rule_signs[j]));
+		if (i >= items.size())
+		{	// composed unit rules follow the rules of the grammar
+			verify(r.signs.size() == 1 && r.sub_count == 1);
+			unit_rules.insert({ r.src, r.signs[0] });
+		}
+		else
+		{
+			verify(r.src == items[i].first);
+			if (items[i].second)
+			{
+				r.func = items[i].second->second;
+				r.on_match = items[i].second->on_match;
+				r.list = items[i].second->list;
 			}
 		}
-	} while (!NEW.empty());
-	//alert();
+		rules.push_back(std::move(r));
+	}
+	for (int i = 0; i != T.callback_count; ++i)
+	{
+		auto item = T.callback_items + i * 3;
+		verify(item[1] < rules.size() && item[2] < rules[item[1]].on_match.size());
+	}
+}
+
+void parser::link_tables()
+{
+	auto& T = packed;
+	symbol_name.clear();
+	symbol_id.clear();
+	for (symbol i = 0; i != T.sign_count; ++i)
+	{
+		symbol_name.push_back(T.sign_pool + T.sign_offset[i]);
+		symbol_id[symbol_name.back()] = i;
+	}
+	is_term.assign(T.sign_count, 0);
+	for (auto& sgn: terms) is_term[symbol_id.at(sgn)] = 1;
+	reinterpret_symbol.assign(T.sign_count, {});
+	for (auto& v: reinterpret_map)
+		for (auto& dest: v.second)
+			reinterpret_symbol[symbol_id.at(v.first)][dest.first] = symbol_id.at(dest.second);
+	rule_lhs.clear();
+	rule_length.clear();
+	is_unit.clear();
+	for (rule_id i = 0; i != rules.size(); ++i)
+	{
+		rule_lhs.push_back(T.rule_src[i]);
+		rule_length.push_back(rules[i].signs.size() > 1 || rules[i].signs[0] != empty_sign ? rules[i].signs.size() : 0);
+		is_unit.push_back(rules[i].signs.size() == 1 && rules[i].sub_count == 1 &&
+			unit_rules.count({ rules[i].src, rules[i].signs[0] }));
+	}
+	is_list.clear();
+	for (auto& r: rules)
+	{	// the node of the first sign is one of its rules, as no unit rule stands for it
+		auto stands_in = std::any_of(unit_rules.begin(), unit_rules.end(),
+			[&](const std::pair<sign, sign>& u) { return u.first == r.src; });
+		if (r.list && (r.signs[0] != r.src || stands_in))
+			throw err("a list rule of " + r.src + " must start with " + r.src);
+		is_list.push_back(r.list);
+	}
+	end_symbol = symbol_id.at(stack_bottom);
+	rule_symbol.clear();
+	for (auto& r: lex.rules_list)
+	{
+		auto itr = symbol_id.find(r.token_name);
+		rule_symbol.push_back(itr != symbol_id.end() ? itr->second : -1);
+	}
+	state_callback.assign(T.state_count, nullptr);
+	for (int i = 0; i != T.callback_count; ++i)
+	{
+		auto item = T.callback_items + i * 3;
+		state_callback[item[0]] = rules[item[1]].on_match[item[2]].second;
+	}
+}
+
+void parser::export_tables(table_image& image) const
+{
+	auto& T = packed;
+	image = table_image();
+	auto pool_end = T.sign_count ? T.sign_offset[T.sign_count - 1] : 0;
+	pool_end += strlen(T.sign_pool + pool_end) + 1;
+	image.sign_pool.assign(T.sign_pool, pool_end);
+	image.sign_offset.assign(T.sign_offset, T.sign_offset + T.sign_count);
+	image.rule_src.assign(T.rule_src, T.rule_src + T.rule_count);
+	image.rule_sign_begin.assign(T.rule_sign_begin, T.rule_sign_begin + T.rule_count + 1);
+	image.rule_signs.assign(T.rule_signs, T.rule_signs + T.rule_sign_begin[T.rule_count]);
+	image.rule_sub_count.assign(T.rule_sub_count, T.rule_sub_count + T.rule_count);
+	image.action_default.assign(T.action_default, T.action_default + T.state_count);
+	image.action_base.assign(T.action_base, T.action_base + T.state_count);
+	image.goto_base.assign(T.goto_base, T.goto_base + T.state_count);
+	image.comb_check.assign(T.comb_check, T.comb_check + T.comb_size);
+	image.comb_value.assign(T.comb_value, T.comb_value + T.comb_size);
+	image.callback_items.assign(T.callback_items, T.callback_items + T.callback_count * 3);
+	auto& L = T.lexer;
+	image.char_class.assign(L.char_class, L.char_class + 256);
+	image.lex_table.assign(L.table, L.table + L.state_count * L.class_count);
+	image.lex_accept.assign(L.accept, L.accept + L.state_count * 3);
+	image.class_count = L.class_count;
+	image.lex_start = L.start;
+	image.lex_rule_count = L.rule_count;
+	std::size_t pool_size = 0;
+	for (int i = 0; i != L.keyword_slots; ++i)
+	{
+		auto offset = L.keyword_slot[i * 2];
+		if (offset >= 0) pool_size = std::max(pool_size, offset + strlen(L.keyword_pool + offset) + 1);
+	}
+	image.keyword_pool.assign(L.keyword_pool, pool_size);
+	image.keyword_disp.assign(L.keyword_disp, L.keyword_disp + L.keyword_buckets);
+	image.keyword_slot.assign(L.keyword_slot, L.keyword_slot + L.keyword_slots * 2);
+	image.keyword_length = L.keyword_length;
+}
+
+parser::tables parser::table_image::view() const
+{
+	return {
+		sign_pool.data(), sign_offset.data(), static_cast<int>(sign_offset.size()),
+		rule_src.data(), rule_sign_begin.data(), rule_signs.data(), rule_sub_count.data(), static_cast<int>(rule_src.size()),
+		action_default.data(), action_base.data(), goto_base.data(), static_cast<int>(action_default.size()),
+		comb_check.data(), comb_value.data(), static_cast<int>(comb_check.size()),
+		callback_items.data(), static_cast<int>(callback_items.size() / 3),
+		{ char_class.data(), class_count, lex_table.data(), lex_accept.data(),
+			static_cast<int>(lex_accept.size() / 3), lex_start, lex_rule_count,
+			keyword_pool.c_str(), keyword_disp.data(), static_cast<int>(keyword_disp.size()),
+			keyword_slot.data(), static_cast<int>(keyword_slot.size() / 2), keyword_length },
+		key
+	};
+}
+
+void parser::table_image::write_binary(std::ostream& os, std::uint64_t key) const
+{	// int words: magic, key, then every array as its size and items
+	auto write = [&](std::int32_t n) { os.write(reinterpret_cast<const char*>(&n), sizeof n); };
+	auto write_array = [&](const std::vector<int>& vec)
+	{
+		write(vec.size());
+		for (auto n: vec) write(n);
+	};
+	auto write_pool = [&](const std::string& pool)
+	{
+		write(pool.size());
+		os.write(pool.data(), pool.size());
+		for (auto n = pool.size(); n % 4; ++n) os.put('\0');
+	};
+	write(0x33544357);		// "WCT3"
+	write(key & 0xffffffff);
+	write(key >> 32);
+	write_pool(sign_pool);
+	for (auto vec: { &sign_offset, &rule_src, &rule_sign_begin, &rule_signs, &rule_sub_count,
+		&action_default, &action_base, &goto_base, &comb_check, &comb_value, &callback_items,
+		&char_class, &lex_table, &lex_accept })
+		write_array(*vec);
+	write_pool(keyword_pool);
+	write_array(keyword_disp);
+	write_array(keyword_slot);
+	write(keyword_length);
+	write(class_count);
+	write(lex_start);
+	write(lex_rule_count);
+}
+
+bool parser::table_image::view_binary(pchar p, std::size_t n, std::uint64_t key, tables& T)
+{
+	auto word = reinterpret_cast<const std::int32_t*>(p);
+	auto end = word + n / 4;
+	auto read = [&](int& v) { if (word == end) return false; v = *word++; return true; };
+	auto read_array = [&](const int*& arr, int& size)
+	{
+		if (!read(size) || size < 0 || size > end - word) return false;
+		arr = word;
+		word += size;
+		return true;
+	};
+	auto read_pool = [&](pchar& pool, int& size)
+	{	// chars separated by '\0', padded to a word
+		if (!read(size) || size < 0 || (size + 3) / 4 > end - word) return false;
+		pool = reinterpret_cast<pchar>(word);
+		word += (size + 3) / 4;
+		return !size || !pool[size - 1];
+	};
+	int magic, lo, hi, pool_size, keyword_pool_size;
+	if (!read(magic) || magic != 0x33544357 || !read(lo) || !read(hi) ||
+		(static_cast<std::uint32_t>(lo) | static_cast<std::uint64_t>(static_cast<std::uint32_t>(hi)) << 32) != key)
+		return false;
+	if (!read_pool(T.sign_pool, pool_size) || pool_size == 0) return false;
+	int rule_sign_begin_size, rule_signs_size, rule_sub_count_size, action_base_size, goto_base_size,
+		comb_value_size, callback_size, char_class_size, table_size, accept_size, keyword_slot_size;
+	if (!read_array(T.sign_offset, T.sign_count) || !read_array(T.rule_src, T.rule_count) ||
+		!read_array(T.rule_sign_begin, rule_sign_begin_size) || !read_array(T.rule_signs, rule_signs_size) ||
+		!read_array(T.rule_sub_count, rule_sub_count_size) || !read_array(T.action_default, T.state_count) ||
+		!read_array(T.action_base, action_base_size) || !read_array(T.goto_base, goto_base_size) ||
+		!read_array(T.comb_check, T.comb_size) || !read_array(T.comb_value, comb_value_size) ||
+		!read_array(T.callback_items, callback_size) || !read_array(T.lexer.char_class, char_class_size) ||
+		!read_array(T.lexer.table, table_size) || !read_array(T.lexer.accept, accept_size) ||
+		!read(T.lexer.class_count) || !read(T.lexer.start) || !read(T.lexer.rule_count) ||
+		!read_pool(T.lexer.keyword_pool, keyword_pool_size) ||
+		!read_array(T.lexer.keyword_disp, T.lexer.keyword_buckets) || !read_array(T.lexer.keyword_slot, keyword_slot_size) ||
+		!read(T.lexer.keyword_length))
+		return false;
+	if (!keyword_pool_size) T.lexer.keyword_pool = "";
+	T.key = key;
+	T.callback_count = callback_size / 3;
+	T.lexer.state_count = accept_size / 3;
+	T.lexer.keyword_slots = keyword_slot_size / 2;
+	// every index must be in range, so a broken file is a miss rather than a crash
+	auto in_range = [](const int* arr, int size, int step, int low, int limit)
+	{
+		for (int i = 0; i < size; i += step) if (arr[i] < low || arr[i] >= limit) return false;
+		return true;
+	};
+	auto pow2 = [](int n) { return n >= 0 && !(n & (n - 1)); };
+	auto ascending = [](const int* arr, int size, int limit)
+	{
+		for (int i = 0; i + 1 < size; ++i) if (arr[i] > arr[i + 1]) return false;
+		return size > 0 && arr[0] == 0 && arr[size - 1] == limit;
+	};
+	if (!(in_range(T.sign_offset, T.sign_count, 1, 0, pool_size) &&
+		T.rule_count > 0 && rule_sub_count_size == T.rule_count && rule_sign_begin_size == T.rule_count + 1 &&
+		in_range(T.rule_src, T.rule_count, 1, 0, T.sign_count) &&
+		in_range(T.rule_signs, rule_signs_size, 1, 0, T.sign_count) &&
+		ascending(T.rule_sign_begin, rule_sign_begin_size, rule_signs_size) &&
+		T.state_count > 0 && action_base_size == T.state_count && goto_base_size == T.state_count &&
+		comb_value_size == T.comb_size && T.comb_size >= T.sign_count &&
+		in_range(T.action_default, T.state_count, 1, a_accept, T.rule_count) &&
+		in_range(T.action_base, T.state_count, 1, 0, T.comb_size - T.sign_count + 1) &&
+		in_range(T.goto_base, T.state_count, 1, 0, T.comb_size - T.sign_count + 1) &&
+		in_range(T.comb_check, T.comb_size, 1, -1, T.comb_size) &&
+		callback_size % 3 == 0 && in_range(T.callback_items, callback_size, 3, 0, T.state_count) &&
+		in_range(T.callback_items + 1, callback_size - 1, 3, 0, T.rule_count) &&
+		char_class_size == 256 && T.lexer.class_count > 0 &&
+		in_range(T.lexer.char_class, 256, 1, 0, T.lexer.class_count) &&
+		accept_size % 3 == 0 && table_size == T.lexer.state_count * T.lexer.class_count &&
+		in_range(T.lexer.table, table_size, 1, 0, T.lexer.state_count) &&
+		T.lexer.start >= 0 && T.lexer.start < T.lexer.state_count &&
+		in_range(T.lexer.accept, accept_size, 3, -1, T.lexer.rule_count) &&
+		in_range(T.lexer.accept + 1, accept_size - 1, 3, -1, T.lexer.rule_count) &&
+		in_range(T.lexer.accept + 2, accept_size - 2, 3, 0, 2) &&
+		keyword_slot_size % 2 == 0 && pow2(T.lexer.keyword_buckets) && pow2(T.lexer.keyword_slots) &&
+		(T.lexer.keyword_buckets == 0) == (T.lexer.keyword_slots == 0) &&
+		T.lexer.keyword_length >= 0 && (T.lexer.keyword_slots || !T.lexer.keyword_length)))
+		return false;
+	for (int i = 0; i != T.lexer.keyword_slots; ++i)
+	{	// a keyword is a word of the pool and a rule
+		auto offset = T.lexer.keyword_slot[i * 2], rule = T.lexer.keyword_slot[i * 2 + 1];
+		if (offset >= keyword_pool_size || offset < -1 || (offset >= 0 && (rule < 0 || rule >= T.lexer.rule_count)))
+			return false;
+	}
+	for (int i = 0; i != T.state_count; ++i)
+	{	// actions of ACTION rows and states of GOTO rows
+		auto a = T.action_base[i], g = T.goto_base[i];
+		for (int sym = 0; sym != T.sign_count; ++sym)
+		{
+			if (T.comb_check[a + sym] == a && !(T.comb_value[a + sym] >= a_accept && T.comb_value[a + sym] < T.rule_count))
+				return false;
+			if (T.comb_check[g + sym] == g && !(T.comb_value[g + sym] >= 0 && T.comb_value[g + sym] < T.state_count))
+				return false;
+		}
+	}
+	return true;
+}
+
+void parser::table_image::write_source(std::ostream& os, const std::string& name) const
+{
+	auto write_array = [&](const char* type, const char* id, const std::vector<int>& vec)
+	{
+		os << "constexpr " << type << " " << id << "[] =\n{";
+		for (int i = 0; i != vec.size(); ++i)
+			os << (i % 16 ? " " : "\n\t") << vec[i] << ",";
+		if (vec.empty()) os << " 0";
+		os << "\n};\n";
+	};
+	os << "// generated by wcgen from the rules in wc.h, do not edit\n";
+	os << "#ifndef __W_TABLES__HEADER_FILE\n#define __W_TABLES__HEADER_FILE\n";
+	os << "#include \"parser.h\"\n\n";
+	os << "namespace " << name << "_data\n{\n\n";
+	write_array("char", "sign_pool", std::vector<int>(sign_pool.begin(), sign_pool.end()));
+	write_array("int", "sign_offset", sign_offset);
+	write_array("int", "rule_src", rule_src);
+	write_array("int", "rule_sign_begin", rule_sign_begin);
+	write_array("int", "rule_signs", rule_signs);
+	write_array("int", "rule_sub_count", rule_sub_count);
+	write_array("int", "action_default", action_default);
+	write_array("int", "action_base", action_base);
+	write_array("int", "goto_base", goto_base);
+	write_array("int", "comb_check", comb_check);
+	write_array("int", "comb_value", comb_value);
+	write_array("int", "callback_items", callback_items);
+	write_array("int", "char_class", char_class);
+	write_array("int", "lex_table", lex_table);
+	write_array("int", "lex_accept", lex_accept);
+	write_array("char", "keyword_pool", std::vector<int>(keyword_pool.begin(), keyword_pool.end()));
+	write_array("int", "keyword_disp", keyword_disp);
+	write_array("int", "keyword_slot", keyword_slot);
+	auto T = view();
+	auto& d = name;
+	os << "\n}\n\n";
+	os << "constexpr lr_parser::parser::tables " << name << " =\n{\n";
+	os << "\t" << d << "_data::sign_pool, " << d << "_data::sign_offset, " << T.sign_count << ",\n";
+	os << "\t" << d << "_data::rule_src, " << d << "_data::rule_sign_begin, " << d << "_data::rule_signs, "
+		<< d << "_data::rule_sub_count, " << T.rule_count << ",\n";
+	os << "\t" << d << "_data::action_default, " << d << "_data::action_base, "
+		<< d << "_data::goto_base, " << T.state_count << ",\n";
+	os << "\t" << d << "_data::comb_check, " << d << "_data::comb_value, " << T.comb_size << ",\n";
+	os << "\t" << d << "_data::callback_items, " << T.callback_count << ",\n";
+	os << "\t{ " << d << "_data::char_class, " << T.lexer.class_count << ", " << d << "_data::lex_table, "
+		<< d << "_data::lex_accept, " << T.lexer.state_count << ", " << T.lexer.start << ", "
+		<< T.lexer.rule_count << ",\n\t\t" << d << "_data::keyword_pool, " << d << "_data::keyword_disp, "
+		<< T.lexer.keyword_buckets << ", " << d << "_data::keyword_slot, " << T.lexer.keyword_slots << ", "
+		<< T.lexer.keyword_length << " },\n";
+	os << "\t0x" << std::hex << key << std::dec << "ull\n";
+	os << "};\n\n#endif\n";
 }
 
 lexer::init_rules parser::expr_gen(lexer::init_rules& lR, init_rules& iR, expr_init_rules& eiR)
@@ -391,13 +1112,14 @@ lexer::init_rules parser::expr_gen(lexer::init_rules& lR, init_rules& iR, expr_i
 				int sub_pos = v.asl == right_asl ? 0 : sz - 1;
 				for (int i = 0; i < sz; ++i)
 				{
-					if (arr[i].name == "param")
+					auto& name = lex.name_of(arr[i]);
+					if (name == "param")
 					{
 						str += i == sub_pos ? r_next : r_this + " ";
 					}
-					else if (arr[i].name == "piece")
+					else if (name == "piece")
 					{
-						std::string& s = arr[i].attr->value;
+						std::string s = lex.text_of(arr[i]);
 						char* ptr = const_cast<char*>(s.c_str());
 						char* pst = ptr;
 						while (ptr = strstr(ptr, "\\%"))
@@ -408,23 +1130,25 @@ lexer::init_rules parser::expr_gen(lexer::init_rules& lR, init_rules& iR, expr_i
 						lst.push_back(s);
 						str += s + " ";
 					}
-					else if (arr[i].name == "pack")
+					else if (name == "pack")
 					{
 						str += tag + "pk ";
 					}
-					else if (arr[i].name == "pattern")
+					else if (name == "pattern")
 					{
-						str += std::string(arr[i].attr->value.c_str() + 1) + " ";
+						str += lex.text_of(arr[i]).substr(1) + " ";
 					}
 				}
 				iR.back().second.push_back({ str, v.func });
 				//alert("", str);
 			}
 			iR.back().second.push_back({ r_next, forward });
+			unit_rules.insert({ r_this, r_next });
 			//alert("", r_next);
 			r_this = tag + int2str(i);
 		}
 		iR.push_back( { r_this, { { tag + "elem", forward } } } );
+		unit_rules.insert({ r_this, tag + "elem" });
 	};
 	//alert(r_this, "base");
 	generate_by_name("expr");
@@ -452,85 +1176,428 @@ lexer::init_rules parser::expr_gen(lexer::init_rules& lR, init_rules& iR, expr_i
 
 void parser::parse(pchar buffer)
 {
-	std::queue<token> tokens;
-	lex.input(buffer);
-	do {
-		tokens.push(lex.next_token());
-	} while (tokens.back());	// $ token eostack bool false
+	parse(buffer, strlen(buffer));
+}
+
+void parser::parse(pchar buffer, std::size_t n)
+{
+	lex.input(buffer, n);
+	if (lex_threads > 1) lex.lex_ahead(lex_threads);
+	parse(static_cast<token_source&>(lex));
+}
+
+void parser::parse(token_source& source)
+{
+	top_items.clear();
+	global_names.clear();
+	kept_tree = nullptr;
+	auto tree = parse_items(source, nullptr, streaming);
+	if (tree && !streaming)
+	{
+		gen_node::rule_table = rules.data();
+		tree->code_gen(&context);
+	}
+	arena.clear();
+	top_items.clear();
+	cur_node = nullptr;		// later errors have no place in the source
+}
+
+void parser::parse_tree(pchar buffer, std::size_t n)
+{
+	lex.input(buffer, n);
+	if (lex_threads > 1) lex.lex_ahead(lex_threads);
+	top_items.clear();
+	global_names.clear();
+	kept_tree = nullptr;
+	kept_garbage = 0;
+	kept_tree = parse_items(lex, nullptr);
+	kept_size = n;
+}
+
+void parser::reparse(pchar buffer, std::size_t n, const std::vector<edit>& edits)
+{
+	if (!kept_tree) return parse_tree(buffer, n);
+	auto sorted = edits;
+	std::sort(sorted.begin(), sorted.end(), [](const edit& x, const edit& y) { return x.begin < y.begin; });
+	std::vector<long> shift;		// [edit] from old to new offsets behind it
+	std::vector<unsigned> new_end;	// [edit]
+	long delta = 0;
+	for (auto& e: sorted)
+	{
+		if (e.begin > e.end || e.end > kept_size || (!shift.empty() && e.begin < (&e - 1)->end))
+			throw err("edits out of the source or overlapping");
+		delta += static_cast<long>(e.length) - (e.end - e.begin);
+		shift.push_back(delta);
+		new_end.push_back(e.end + delta);
+	}
+	if (kept_size + delta != n) throw err("edits do not match the size of the source");
+	if (sorted.empty())
+	{	// only the last item is parsed again
+		sorted.push_back({ static_cast<unsigned>(n), static_cast<unsigned>(n), 0 });
+		shift.push_back(0);
+		new_end.push_back(n);
+	}
+	// the last item before an old offset whose next token is untouched
+	auto item_before = [](const std::vector<top_item>& items, unsigned offset)
+	{
+		return std::lower_bound(items.begin(), items.end(), offset,
+			[](const top_item& t, unsigned offset) { return t.offset + t.length < offset; }) - items.begin() - 1;
+	};
+	auto k = item_before(top_items, sorted[0].begin);
+	if (k < 0 || kept_garbage > n) return parse_tree(buffer, n);		// the dropped nodes stay in the arena until then
+	auto old_items = std::move(top_items);
+	auto old_names = global_names;
+	auto& old_tree = *old_items.back().tree;
+	std::vector<AST*> old_list(old_tree.sub_first, old_tree.sub_first + (is_list[old_tree.id] ? old_tree.sub_count : 0));
+	top_items.assign(old_items.begin(), old_items.begin() + k + 1);
+	global_names.resize(top_items.back().names);
+	kept_tree = nullptr;
+	std::size_t old_synced = top_items.back().names, new_synced = old_synced;		// same names up to there
+	auto same_names = [&](std::size_t old_count)
+	{	// the global scope now and the old one at old_count differ at most in the names changed since
+		std::unordered_map<unsigned, symbol_type> old_scope;
+		for (auto i = old_synced; i < old_count; ++i) old_scope[old_names[i].name] = old_names[i].symbol;
+		for (auto i = new_synced; i != global_names.size(); ++i) old_scope.emplace(global_names[i].name, global_names[i].previous);
+		for (auto& v: old_scope) if (symbol_of(v.first) != v.second) return false;
+		return true;
+	};
+	bool spliced, complete = false;
+	std::size_t restart = top_items.back().offset;
+	auto at_item = [&](AST* tree)->AST*
+	{	// an item behind an edit that starts at an old item with the same global names has
+		// the same tokens from there, the old items up to the next edit are reused
+		auto& t = top_items.back();
+		auto j = std::upper_bound(new_end.begin(), new_end.end(), t.offset) - new_end.begin();		// edits before t
+		if (j == 0) return nullptr;
+		auto m = std::lower_bound(old_items.begin(), old_items.end(), t.offset - shift[j - 1],
+			[](const top_item& i, unsigned offset) { return i.offset < offset; });
+		if (m == old_items.end() || m->offset != t.offset - shift[j - 1] || !same_names(m->names))
+			return nullptr;
+		auto q = old_items.begin() + (j == sorted.size() ? old_items.size() - 1 : item_before(old_items, sorted[j].begin));
+		if (q <= m) return nullptr;
+		std::vector<AST*> nodes;		// to move behind the edits
+		auto last = q->tree;
+		unsigned from = 0, base = 0;		// the children of the items move from there to base
+		if (is_list[(m + 1)->tree->id])
+		{	// the items behind m are appended to the list, it was cut at m when the parse resumed
+			from = (m + 1)->count - (rules[(m + 1)->tree->id].sub_count - 1);
+			token T(0, t.offset, 0);
+			last = extend_list((m + 1)->tree->id, tree, old_list.data() + from, q->count - from, T);
+			nodes.assign(old_list.begin() + from, old_list.begin() + q->count);
+			base = last->sub_count - (q->count - from);
+		}
+		else
+		{	// the item behind m is reduced from the tree before it
+			(m + 1)->tree->sub_first[0] = tree;
+			nodes.push_back(q->tree);
+		}
+		while (shift[j - 1] && !nodes.empty())
+		{
+			auto p = nodes.back();
+			nodes.pop_back();
+			p->offset += shift[j - 1];
+			for (auto r: p->sub()) if (r != tree) nodes.push_back(r);
+		}
+		auto names = global_names.size();
+		global_names.insert(global_names.end(), old_names.begin() + m->names, old_names.begin() + q->names);
+		for (auto i = m + 1; i != q + 1; ++i)
+		{
+			top_items.push_back(*i);
+			top_items.back().offset += shift[j - 1];
+			top_items.back().tree = i->tree == q->tree ? last : i->tree;
+			top_items.back().count += base - from;
+			top_items.back().names += names - m->names;
+		}
+		old_synced = q->names;
+		new_synced = global_names.size();
+		kept_garbage += t.offset - restart;
+		restart = top_items.back().offset;
+		spliced = true;
+		complete = q + 1 == old_items.end();
+		return last;
+	};
+	lex.input(buffer, n);
+	do
+	{	// up to the end or to the item before the next edit
+		lex.seek(top_items.back().offset);
+		spliced = false;
+		kept_tree = parse_items(lex, at_item);
+	} while (spliced && !complete);
+	if (!spliced) kept_garbage += n - restart;
+	kept_size = n;
+#ifdef WC_DEBUG
+	// the tree must be the one a full parse of the edited source builds, which then is kept
+	auto shape = [](AST* tree)
+	{
+		std::vector<unsigned> nodes;
+		std::vector<AST*> todo = { tree };
+		while (!todo.empty())
+		{
+			auto p = todo.back();
+			todo.pop_back();
+			if (!p) continue;
+			nodes.insert(nodes.end(), { p->id, p->offset, p->sub_count });
+			for (auto r: p->sub()) todo.push_back(r);
+		}
+		return nodes;
+	};
+	auto reparsed = shape(kept_tree);
+	parse_tree(buffer, n);
+	if (shape(kept_tree) != reparsed) throw err("reparse differs from a full parse of the source");
+#endif
+}
+
+void parser::log_scope()
+{	// the scopes of an item are closed at its end, what is left in the log is global
+	for (auto i = item_log; i != symbol_log.size(); ++i)
+	{
+		auto name = symbol_log[i].name;
+		global_names.push_back({ name, symbols[name], symbol_log[i].previous });
+	}
+	item_log = symbol_log.size();
+}
+
+void parser::declare(unsigned name, symbol_type st)
+{
+	if (name >= symbols.size()) symbols.resize(name + 1);
+	symbol_log.push_back({ name, symbols[name] });
+	symbols[name] = st;
+}
+
+void parser::declare_outer(unsigned name, symbol_type st)
+{	// the first change in the innermost scope restores the symbol of the scope around
+	if (scopes.size() == 1) return declare(name, st);
+	if (name >= symbols.size()) symbols.resize(name + 1);
+	auto begin = scopes.back();
+	auto previous = symbol_of(name);
+	for (auto i = symbol_log.size(); i-- != begin; )
+	{
+		if (symbol_log[i].name != name) continue;
+		previous = symbol_log[i].previous;
+		symbol_log[i].previous = st;
+	}
+	symbol_log.insert(symbol_log.begin() + begin, { name, previous });
+	++scopes.back();
+	symbols[name] = st;
+}
+
+void parser::leave_scope()
+{
+	if (scopes.size() == 1) throw err("error when parsing enclosed scope");
+	undo_symbols(scopes.back());
+	scopes.pop_back();
+}
+
+void parser::undo_symbols(std::size_t log_size)
+{
+	while (symbol_log.size() > log_size)
+	{
+		symbols[symbol_log.back().name] = symbol_log.back().previous;
+		symbol_log.pop_back();
+	}
+	item_log = std::min(item_log, log_size);
+}
+
+void parser::reset_symbols()
+{
+	undo_symbols(0);
+	scopes.assign(1, 0);
+}
+
+void parser::generate()
+{
+	if (!kept_tree) throw err("no tree to generate code from");
+	gen_node::rule_table = rules.data();
+	kept_tree->code_gen(&context);
+}
+
+AST* parser::extend_list(rule_id i, AST* left, AST* const* items, unsigned n, token& T)
+{	// the children of a list take a power of 2 slots, so they are copied log n times
+	auto slots = [](unsigned count) { unsigned k = 4; while (k < count) k *= 2; return k; };
+	if (left->id != i)
+	{
+		auto sub = arena.make_sub(slots(n + 1));
+		sub.count = 1;
+		sub[0] = left;
+		left = arena.make<gen_node>(T, i, sub);
+	}
+	auto count = left->sub_count;
+	if (count + n > slots(count))
+	{
+		auto sub = arena.make_sub(slots(count + n));
+		std::copy(left->sub_first, left->sub_first + count, sub.first);
+		left->sub_first = sub.first;
+	}
+	std::copy(items, items + n, left->sub_first + count);
+	left->sub_count = count + n;
+	return left;
+}
+
+AST* parser::parse_items(token_source& source, const std::function<AST*(AST*)>& at_item, bool stream)
+{
+	cur_lines.reset(source.source(), source.source_size());
+	token look;		// the only token read ahead
+	const attr_type* attr = nullptr;
+	symbol sym;
+	auto unexpected = [&]
+	{
+		return parser_err("unexpected token: " + (attr ? attr->value : symbol_name[sym]), look);
+	};
+	auto next = [&]
+	{
+		look = source.next_token();
+		attr = nullptr;
+		sym = end_symbol;
+		if (!look) return;
+		if (look.kind >= static_cast<int>(rule_symbol.size()))
+			throw parser_err("invalid token kind", look);
+		attr = lex.attr_of(look, source.source());
+		sym = rule_symbol[look.kind];
+		if (sym < 0) throw parser_err("unexpected token: " + lex.name_of(look), look);
+	};
 	// if cannot match then alert an error
 	std::stack<state> states;	// $ state bottom
 	states.push(0);
 	std::stack<AST*> signs;
 
-	while (!symbol_lookup.empty())
-		symbol_lookup.pop();			//reset symbols to global context
-	symbol_lookup.push(std::map<std::string, symbol_type>());
+	reset_symbols();			//reset symbols to global context
+	if (top_items.empty()) arena.clear();
+	else
+	{	// go on behind a kept top level item, the scope it left is its names
+		states.push(top_items.back().st);
+		signs.push(top_items.back().tree);
+		signs.top()->sub_count = top_items.back().count;		// a list is cut back to it
+		for (auto& v: global_names) declare(v.name, v.symbol);
+		item_log = symbol_log.size();
+		if (state_callback[states.top()])
+		{
+			state_callback[states.top()](this, *signs.top());
+		}
+	}
 
+	auto action_of = [this](state st, symbol sym)
+	{
+		auto b = packed.action_base[st];
+		return packed.comb_check[b + sym] == b ? packed.comb_value[b + sym] : packed.action_default[st];
+	};
+	auto goto_of = [this](state st, symbol sym)
+	{
+		auto b = packed.goto_base[st];
+		return packed.comb_check[b + sym] == b ? packed.comb_value[b + sym] : 0;
+	};
+	AST* done = nullptr;		// the whole tree, known before the end of the input
+	AST* first_tree = nullptr;		// of no item, it stands for the items generated when streaming
+	AST_arena::position item_start;
+	std::vector<AST*> list_items;
 	auto merge = [&](rule_id i)
 	{
-		auto* p = new gen_node(tokens.front(), rules[i]);
-		if (rules[i].signs.size() > 1 || rules[i].signs[0] != empty_sign)
-		{
-			p->sub.resize(rules[i].sub_count);
-			for (auto itr = p->sub.rbegin(); itr != p->sub.rend(); ++itr)
+		if (is_unit[i])
+		{	// the node of the level below stands for this one
+			states.pop();
+			states.push(goto_of(states.top(), rule_lhs[i]));
+			if (state_callback[states.top()])
 			{
-				*itr = signs.top(); signs.pop();
+				state_callback[states.top()](this, *signs.top());
 			}
-			for (auto& dummy: rules[i].signs) states.pop();
+			return;
 		}
-		signs.push(p);
-		states.push(GOTO[states.top()][rules[i].src]);
-		if (matching_callback_map[states.top()])
-		{
-			matching_callback_map[states.top()](this, *signs.top());
+		if (is_list[i])
+		{	// pop the items and the list before them
+			list_items.resize(rules[i].sub_count - 1);
+			for (auto k = list_items.size(); k--; )
+			{
+				list_items[k] = signs.top(); signs.pop();
+			}
+			auto left = signs.top(); signs.pop();
+			signs.push(extend_list(i, left, list_items.data(), list_items.size(), look));
+			for (int k = 0; k != rule_length[i]; ++k) states.pop();
 		}
-	};
-	bool reinterpret_reset = true;
-	do {
-		auto& sgn = tokens.front().name;
-		if (reinterpret_reset && tokens.front().attr && symbol_lookup.top()[tokens.front().attr->value])
+		else
 		{
-			sgn = reinterpret_map[sgn][symbol_lookup.top()[tokens.front().attr->value]];
-			reinterpret_reset = false;
+			sub_nodes sub;
+			if (rule_length[i])
+			{	// the children are allocated right before the node
+				sub = arena.make_sub(rules[i].sub_count);
+				for (auto k = sub.size(); k--; )
+				{
+					sub[k] = signs.top(); signs.pop();
+				}
+				for (int k = 0; k != rule_length[i]; ++k) states.pop();
+			}
+			signs.push(arena.make<gen_node>(look, i, sub));
 		}
-		//std::cout << states.top() << " " << sgn << " " << ACTION[states.top()][sgn] <<std::endl;
-		switch (ACTION[states.top()][sgn])
+		states.push(goto_of(states.top(), rule_lhs[i]));
+		if (state_callback[states.top()])
 		{
-		case a_move_in:
-			states.push(GOTO[states.top()][sgn]);	// move into a new state
-			if (terms.count(sgn))
+			state_callback[states.top()](this, *signs.top());
+		}
+		if (states.size() == 2 && stream)
+		{	// the start tree holds the first tree and this item only, it is generated
+			// and the first tree stands for the items before the next one again
+			if (first_tree)
 			{
-				signs.push(new term_node(tokens.front()));
+				nodes_kept = false;
+				gen_node::rule_table = rules.data();
+				signs.top()->code_gen(&context);
+				signs.top() = first_tree;
+				cur_node = nullptr;
+				if (nodes_kept) item_start = arena.tell();
+				else arena.rewind(item_start);
 			}
-			if (matching_callback_map[states.top()])
+			else
 			{
-				matching_callback_map[states.top()](this, *signs.top());
+				first_tree = signs.top();
+				item_start = arena.tell();
 			}
-			tokens.pop(); reinterpret_reset = true; break;
-		case a_accept:
-			if (signs.size() == 1 && !tokens.front()) goto SUCCESS;		// accepted
-			else
+		}
+		else if (states.size() == 2)
+		{	// only the start symbol is reduced at the bottom, one more top level item
+			log_scope();
+			top_items.push_back({ look.offset, look.length, signs.top(), signs.top()->sub_count, global_names.size(), states.top() });
+			if (at_item) done = at_item(signs.top());
+		}
+	};
+	bool reinterpret_reset = true, more = true;
+	try {
+		next();
+		do {
+			symbol_type st;
+			if (reinterpret_reset && attr && (st = symbol_of(attr->name)))
 			{
-				while (!signs.empty()) { signs.top()->destroy(); signs.pop(); }
-				throw parser_err(tokens.front()); break;
-			} 
-		case a_error:
-			while (!signs.empty()) { signs.top()->destroy(); signs.pop(); }
-			throw parser_err(tokens.front()); break;
-		default:	// merge rule_id
-			/*std::cout << rules[ACTION[states.top()][tokens.front().name]].src << " -> ";
-			for (auto& v: rules[ACTION[states.top()][tokens.front().name]].signs)
+				auto& dest = reinterpret_symbol[sym];
+				auto itr = dest.find(st);
+				sym = itr != dest.end() ? itr->second : end_symbol;
+				reinterpret_reset = false;
+			}
+			//std::cout << states.top() << " " << symbol_name[sym] << " " << action_of(states.top(), sym) <<std::endl;
+			switch (auto act = action_of(states.top(), sym))
 			{
-				std::cout << v + " ";
-			} 
-			std::cout << std::endl;*/
-			merge(ACTION[states.top()][sgn]);
-		}
-	} while (!tokens.empty());
-	while (!signs.empty()) { signs.top()->destroy(); signs.pop(); } return;
-	SUCCESS:
-	signs.top()->code_gen(&context);
-	signs.top()->destroy();
+			case a_move_in:
+				states.push(goto_of(states.top(), sym));	// move into a new state
+				if (is_term[sym])
+				{
+					signs.push(arena.make<term_node>(look, sym, attr));
+				}
+				if (state_callback[states.top()])
+				{
+					state_callback[states.top()](this, *signs.top());
+				}
+				reinterpret_reset = true;
+				if (!look) more = false;
+				else next();
+				break;
+			case a_accept:
+				if (signs.size() == 1 && !look) return signs.top();		// accepted
+				else throw unexpected();
+			case a_error:
+				throw unexpected();
+			default:	// merge rule_id
+				merge(act);
+				if (done) return done;
+			}
+		} while (more);
+	} catch (...) { arena.clear(); top_items.clear(); throw; }
+	arena.clear(); top_items.clear(); return nullptr;
 }
 
 }
@@ -5,14 +5,24 @@
 #include <cstdio>
 #include <stack>
 #include <queue>
+#include <unordered_map>
+#include <ostream>
+#include <sstream>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
 #include "utility.h"
 #include "lexer.h"
+#include "file_map.h"
 // TODO: modify this
 
 namespace lr_parser
 {
 
 using asl_option = enum { left_asl, right_asl };
+	// slr_lookahead : reduce on the FOLLOW set of the rule
+	// lalr_lookahead : reduce on the LALR(1) lookahead set of the rule in its state
+using lookahead_option = enum { slr_lookahead, lalr_lookahead };
 
 struct oper_node;
 
@@ -25,8 +35,10 @@ class parser
 	using action = int;		// > 0: use rule_id; 0: error; -1: move in; -2: accept
 	using rule_id = int;	// rule_id > 0 : S -> aBX.
 	using state = int;		// state > 0
+	using symbol = int;		// interned sign
 	using item = std::pair<rule_id, int>;	// rule_id, dot_pos
-	using closure = std::set<item>;
+	using kernel = std::vector<item>;
+	using symbol_set = std::vector<std::uint64_t>;	// bitset of symbols
 	
 	static const action a_move_in;
 	static const action a_accept;
@@ -45,12 +57,16 @@ public:
 		int sub_count;
 		handler func;
 		std::vector<std::pair<int, matching_callback>> on_match;
+		bool list;
 	};
 	struct init_rule_item
 	{
 		std::string first;
 		handler second;
 		std::vector<std::pair<int, matching_callback>> on_match;
+		// a rule X -> X ... of a list, its node takes the children of the X node if that is
+		// one of this rule too, so its handler gets the whole list [first X, items...]
+		bool list;
 	};
 	struct reinterpret_item
 	{
@@ -61,29 +77,195 @@ public:
 	using init_rules = std::vector<std::pair<std::string, std::vector<init_rule_item>>>;
 	using expr_init_rules = std::vector<std::vector<oper_node>>;
 	using reinterpret_list = std::vector<std::pair<std::string, std::vector<reinterpret_item>>>;
+	struct tables
+	{	// everything the ctor generates as plain arrays, see wcgen.cpp
+		const char* sign_pool;			// sign names separated by '\0', a symbol is the index of its name
+		const int* sign_offset;			// [sign_count]
+		int sign_count;
+		const int* rule_src;			// [rule_count] symbol
+		const int* rule_sign_begin;		// [rule_count + 1] into rule_signs
+		const int* rule_signs;
+		const int* rule_sub_count;		// [rule_count]
+		int rule_count;
+		// rows of ACTION and GOTO share one comb vector, ACTION[state][symbol] is
+		// comb_value[action_base[state] + symbol] if comb_check there is action_base[state],
+		// else action_default[state], GOTO[state][symbol] is looked up the same way from goto_base
+		const int* action_default;		// [state_count]
+		const int* action_base;			// [state_count]
+		const int* goto_base;			// [state_count]
+		int state_count;
+		const int* comb_check;			// [comb_size]
+		const int* comb_value;			// [comb_size]
+		int comb_size;
+		const int* callback_items;		// state, rule_id, index of on_match
+		int callback_count;
+		dfa::tables lexer;
+		std::uint64_t key;				// grammar_hash of the rules they were generated from
+	};
+	struct table_image
+	{	// storage of the generated tables
+		std::string sign_pool;
+		std::vector<int> sign_offset, rule_src, rule_sign_begin, rule_signs, rule_sub_count,
+			action_default, action_base, goto_base, comb_check, comb_value, callback_items;
+		std::vector<int> char_class, lex_table, lex_accept;
+		int class_count = 0, lex_start = 0, lex_rule_count = 0;
+		std::string keyword_pool;
+		std::vector<int> keyword_disp, keyword_slot;
+		int keyword_length = 0;
+		std::uint64_t key = 0;
+		tables view() const;
+		// write as a c++ header of constexpr arrays
+		void write_source(std::ostream& os, const std::string& name) const;
+		// write as a cache file, key is the hash of the rules
+		void write_binary(std::ostream& os, std::uint64_t key) const;
+		// view a cache file in place, returns false if it is broken or generated from other rules
+		static bool view_binary(pchar p, std::size_t n, std::uint64_t key, tables& T);
+	};
+	struct table_cache
+	{	// directory of the tables generated for each grammar
+		std::string dir;
+	};
+	struct edit
+	{	// chars [begin, end) of the source parsed before were replaced by length chars
+		unsigned begin, end, length;
+	};
 public:
 	// no default ctor allowed
 	// init with rules and a start node (default "S")
-	parser(lexer::init_rules&, init_rules&, expr_init_rules&, const reinterpret_list& = {}, std::string s = "S");
+	parser(lexer::init_rules&, init_rules&, expr_init_rules&, const reinterpret_list& = {}, std::string s = "S",
+		lookahead_option la = slr_lookahead);
+	// init with tables generated from the same rules, nothing is built at runtime
+	// they are checked against the hash of the rules, la is the option they were built with
+	parser(lexer::init_rules&, init_rules&, expr_init_rules&, const reinterpret_list&, const tables&, std::string s = "S",
+		lookahead_option la = slr_lookahead);
+	// init with tables cached in a directory, they are generated and saved only if not found
+	parser(lexer::init_rules&, init_rules&, expr_init_rules&, const reinterpret_list&, const table_cache&, std::string s = "S",
+		lookahead_option la = slr_lookahead);
 	// derive reserved
 	virtual ~parser() = default;
 public:
 	virtual void parse(pchar buffer);
+	// parse n chars in place, buffer needs no '\0' at its end
+	virtual void parse(pchar buffer, std::size_t n);
+	// parse the tokens pulled from a source, their kinds are the rules of the lexer
+	virtual void parse(token_source& source);
+	// parse and keep the tree, no code is generated
+	void parse_tree(pchar buffer, std::size_t n);
+	// parse the kept tree again after edits, only the top level items near the edits are
+	// parsed, the others are reused, buffer is the whole edited source
+	void reparse(pchar buffer, std::size_t n, const std::vector<edit>& edits);
+	// generate code from the kept tree, its source must still be alive
+	void generate();
+	// the token kind of a lexer rule, -1 if none
+	int token_kind(const std::string& token_name) const
+		{ return lex.rule_of(token_name); }
+	// lex a large buffer on this many threads before parsing it
+	void set_lex_threads(unsigned n)
+		{ lex_threads = n; }
+	// parse generates each top level item and drops its nodes before the next one is parsed,
+	// the start rules must generate their children in order like expand does
+	void set_streaming(bool on)
+		{ streaming = on; }
+	void export_tables(table_image& image) const;
+	// the key of the tables generated from the rules, see tables::key
+	static std::uint64_t grammar_hash(const lexer::init_rules&, const init_rules&, const expr_init_rules&,
+		const reinterpret_list&, const std::string& s, lookahead_option la);
 private:
+	struct cached_tables
+	{
+		file_map file;
+		table_image image;		// used if the cache cannot be written
+		tables T;
+	};
+	parser(lexer::init_rules&, init_rules&, expr_init_rules&, const reinterpret_list&,
+		const std::shared_ptr<const cached_tables>&, const std::string& s, lookahead_option la);
+	static std::shared_ptr<const cached_tables> open_cache(const table_cache&, lexer::init_rules, init_rules,
+		expr_init_rules, const reinterpret_list&, const std::string& s, lookahead_option la);
 	lexer::init_rules expr_gen(lexer::init_rules&, init_rules&, expr_init_rules&);
+	void register_signs(lexer::init_rules&, init_rules&, const reinterpret_list&, lexer_base::init_rules&);
+	void build_tables(init_rules&, lexer_base::init_rules&, const std::string& s, lookahead_option la);
+	static std::vector<std::map<rule_id, symbol_set>> lalr_lookaheads(const std::vector<kernel>& closures,
+		const std::vector<std::vector<state>>& GOTO, const std::vector<symbol>& lhs, const std::vector<std::vector<symbol>>& rhs,
+		const std::vector<symbol_set>& FIRST, symbol empty, symbol bottom);
+	void load_tables(init_rules&, const std::string& s);
+	void pack_tables(const std::vector<sign>& names, const std::vector<std::vector<action>>& ACTION,
+		const std::vector<std::vector<state>>& GOTO, const std::map<state, std::pair<rule_id, int>>& callback_item);
+	void link_tables();
+	// the node of a list rule with the items behind its first sign, left is that one
+	AST* extend_list(rule_id i, AST* left, AST* const* items, unsigned n, token& T);
+	// run the LR driver from the start or behind the last kept top level item,
+	// at_item returns the whole tree if the rest of it is known
+	// with stream each item is generated and dropped instead
+	AST* parse_items(token_source& source, const std::function<AST*(AST*)>& at_item, bool stream = false);
+	// log the names the last top level item changed in the scope it leaves
+	void log_scope();
+	// the symbol of a name of the lexer in the innermost scope, 0 if none
+	symbol_type symbol_of(unsigned name) const
+		{ return name < symbols.size() ? symbols[name] : 0; }
+	void declare(unsigned name, symbol_type st);
+	// declare in the scope around the innermost one too
+	void declare_outer(unsigned name, symbol_type st);
+	void leave_scope();
+	// undo the changes logged from there
+	void undo_symbols(std::size_t log_size);
+	void reset_symbols();
 protected:
 	AST_global_context context;
 	std::set<sign> signs, terms, gens;
 	// a map from token name to gen rules
 	std::vector<rule> rules;
-	std::vector<std::map<sign, action>> ACTION;		// [state][sign]->action->rule_id
-	std::vector<std::map<sign, state>> GOTO;		// [state][sign]->state
-	std::map<state, matching_callback> matching_callback_map;
+	// level -> next level of the expressions, forward only, so no node is built for them
+	std::set<std::pair<sign, sign>> unit_rules;
+	tables packed;					// ACTION/GOTO, in table_storage unless precompiled
+	table_image table_storage;
+	std::vector<sign> symbol_name;
+	std::unordered_map<sign, symbol> symbol_id;
+	std::vector<char> is_term;				// [symbol]
+	std::vector<symbol> rule_lhs;			// [rule_id]
+	std::vector<int> rule_length;			// [rule_id] states to pop on merge
+	std::vector<char> is_unit;				// [rule_id] merged without a node, see unit_rules
+	std::vector<char> is_list;				// [rule_id] see init_rule_item
+	std::vector<matching_callback> state_callback;		// [state]
+	std::vector<symbol> rule_symbol;		// [lexer rule] -1 if the parser does not know it
+	symbol end_symbol;
 	// lexer
 	lexer lex;
+	unsigned lex_threads = 1;
+	bool streaming = false;
+	std::shared_ptr<const cached_tables> cached;		// keeps the mapped tables alive
 private:
-	std::stack<std::map<std::string, symbol_type>> symbol_lookup;
+	AST_arena arena;		// nodes of the tree being parsed
+	struct top_item
+	{	// the parse between two top level items
+		unsigned offset, length;		// the first token of the next item
+		AST* tree;						// of the items before
+		unsigned count;					// children of tree then, a list grows in place
+		std::size_t names;				// global names declared before
+		state st;
+	};
+	struct global_name
+	{
+		unsigned name;
+		symbol_type symbol, previous;		// previous is the one before its item
+	};
+	std::vector<top_item> top_items;
+	std::vector<global_name> global_names;		// the changes of the global scope in order
+	AST* kept_tree = nullptr;		// see parse_tree
+	std::size_t kept_size = 0;
+	std::size_t kept_garbage = 0;	// chars parsed again since the tree was parsed whole
+	// a scope changes the symbols of names in place and logs what it overwrote,
+	// entering one is a mark in the log and leaving it undoes the log up to the mark
+	std::vector<symbol_type> symbols;		// [name]
+	struct symbol_change
+	{
+		unsigned name;
+		symbol_type previous;
+	};
+	std::vector<symbol_change> symbol_log;
+	std::vector<std::size_t> scopes;		// the log size when each scope was entered
+	std::size_t item_log = 0;				// the log size at the last top level item
 	std::map<std::string, std::map<symbol_type, std::string>> reinterpret_map;
+	std::vector<std::map<symbol_type, symbol>> reinterpret_symbol;		// [symbol]
 public:
 	static const handler forward;
 	static const handler empty;
@@ -94,28 +276,15 @@ public:
 	static const symbol_type is_template_class_symbol;
 
 	static void enter_block(parser* this_parser, AST& node)
-		{ this_parser->symbol_lookup.push(this_parser->symbol_lookup.top()); }
+		{ this_parser->scopes.push_back(this_parser->symbol_log.size()); }
 	static void leave_block(parser* this_parser, AST& node)
-		{ this_parser->symbol_lookup.pop(); 
-			if (this_parser->symbol_lookup.empty()) throw err("error when parsing enclosed scope"); }
+		{ this_parser->leave_scope(); }
 	static void register_type(parser* this_parser, AST& node)
-		{ this_parser->symbol_lookup.top()[static_cast<term_node&>(node).data.attr->value] = is_type_symbol; }
+		{ this_parser->declare(static_cast<term_node&>(node).attr->name, is_type_symbol); }
 	static void register_template_func(parser* this_parser, AST& node)
-		{
-			auto map = std::move(this_parser->symbol_lookup.top());
-			this_parser->symbol_lookup.pop();
-			this_parser->symbol_lookup.top()[static_cast<term_node&>(node).data.attr->value] = is_template_func_symbol;
-			this_parser->symbol_lookup.push(std::move(map));
-			this_parser->symbol_lookup.top()[static_cast<term_node&>(node).data.attr->value] = is_template_func_symbol;
-		}
+		{ this_parser->declare_outer(static_cast<term_node&>(node).attr->name, is_template_func_symbol); }
 	static void register_template_class(parser* this_parser, AST& node)
-		{
-			auto map = std::move(this_parser->symbol_lookup.top());
-			this_parser->symbol_lookup.pop();
-			this_parser->symbol_lookup.top()[static_cast<term_node&>(node).data.attr->value] = is_template_class_symbol;
-			this_parser->symbol_lookup.push(std::move(map));
-			this_parser->symbol_lookup.top()[static_cast<term_node&>(node).data.attr->value] = is_template_class_symbol;
-		}
+		{ this_parser->declare_outer(static_cast<term_node&>(node).attr->name, is_template_class_symbol); }
 		
 	template <unsigned attr>
 	static AST_result attribute(gen_node&, AST_context*)
@@ -137,22 +306,26 @@ const std::string parser::empty_sign = " ";
 
 struct gen_node: AST
 {
-	gen_node(token& T, const parser::rule& r): AST(T), func(r.func) {}
-	parser::handler func;	// virtual handler pointer
+	gen_node(token& T, unsigned rule_id, sub_nodes s): AST(T, rule_id, s) {}
+	static const parser::rule* rule_table;		// rules of the parser running code_gen
+	unsigned rule() const
+		{ return id; }
 	virtual AST_result code_gen(AST_context* context) override
 	{	// handle a gen		
 		cur_node = this;
-		return func(*this, context);
+		return rule_table[id].func(*this, context);
 	}
 };
 
+const parser::rule* gen_node::rule_table = nullptr;
+
 // AST handler
 const parser::handler parser::forward = [](gen_node& T, AST_context* context)->AST_result
-	{ return T.sub.empty() ? AST_result() : T[0].code_gen(context); };
+	{ return T.sub().empty() ? AST_result() : T[0].code_gen(context); };
 const parser::handler parser::empty = [](gen_node&, AST_context*)->AST_result
 	{ return AST_result(); };
 const parser::handler parser::expand = [](gen_node& T, AST_context* context)->AST_result
-	{ for (auto p: T.sub) p->code_gen(context); return AST_result(); };
+	{ for (auto p: T.sub()) p->code_gen(context); return AST_result(); };
 
 // parser callback
 const parser::symbol_type parser::is_type_symbol = 1;
@@ -166,9 +339,9 @@ struct expr_gen_err: err
 
 struct parser_err: err
 {
-	parser_err(const std::string& s, unsigned LN = 0, unsigned COL = 0, pchar PTR = nullptr): err(s, LN, COL, PTR)
-	{}
-	parser_err(token& t): err("unexpected token: " + (t.attr ? t.attr->value : t.name), t)
+	parser_err(const std::string& s): err(s)
+	{ located = false; }
+	parser_err(const std::string& s, token& t): err(s, t)
 	{}
 	/*void alert() const override
 	{
@@ -1,20 +1,83 @@
 namespace lr_parser
 {
 
+void line_table::build()
+{	// a newline scan of the whole source, 16 bytes at a time where sse2 is there
+	auto n = size;
+	std::size_t i = 0;
+	starts.push_back(0);
+#if defined(__SSE2__) && defined(__GNUC__)
+	const auto nl = _mm_set1_epi8('\n');
+	for (; i + 16 <= n; i += 16)
+	{
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(base + i)), nl));
+		for (; mask; mask &= mask - 1) starts.push_back(i + __builtin_ctz(mask) + 1);
+	}
+#endif
+	for (; i != n; ++i) if (base[i] == '\n') starts.push_back(i + 1);
+}
+
+void line_table::locate(unsigned offset, unsigned& ln, unsigned& col, pchar& line)
+{
+	if (!base) { line = nullptr; return; }
+	if (starts.empty()) build();
+	ln = std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin() - 1;
+	col = offset - starts[ln];
+	line = base + starts[ln];
+}
+
 void err::alert() const
 {
+	unsigned ln = 0, col = 0;
+	pchar ptr = nullptr;
+	if (located) cur_lines.locate(offset, ln, col, ptr);
 	std::cerr << "wc: ";
 	(ptr ? std::cerr << ln + 1 << ": " << col << ": " : std::cerr) << what() << std::endl;
 	if (ptr)
 	{
 		pchar p = ptr;
-		while (*p && *p != '\n') std::cerr << *p++;
+		while (p != cur_lines.end() && *p != '\n') std::cerr << *p++;
 		std::cerr << std::endl;
 		for (p = ptr; p < ptr + col; ++p) std::cerr << (*p != '\t' ? ' ' : '\t');
 		std::cerr << '^';
 	}
 }
 
+void* AST_arena::allocate(std::size_t n, std::size_t align)
+{
+	auto aligned = [align](char* p)
+		{ return p + (-reinterpret_cast<std::uintptr_t>(p) & (align - 1)); };
+	if (!cur || aligned(cur) + n > end)
+	{	// a node larger than a block gets a block of its own
+		auto size = std::max(block_size, n + align);
+		blocks.emplace_back(new char[size]);
+		if (blocks.size() == 1) first_size = size;
+		cur = blocks.back().get();
+		end = cur + size;
+	}
+	auto p = aligned(cur);
+	cur = p + n;
+	return p;
+}
+
+void AST_arena::clear()
+{
+	for (auto itr = dtors.rbegin(); itr != dtors.rend(); ++itr) itr->second(itr->first);
+	dtors.clear();
+	if (blocks.size() > 1) blocks.resize(1);
+	cur = blocks.empty() ? nullptr : blocks[0].get();
+	end = cur ? cur + first_size : nullptr;
+}
+
+void AST_arena::rewind(const position& p)
+{
+	for (auto i = dtors.size(); i-- > p.dtors; ) dtors[i].second(dtors[i].first);
+	dtors.resize(p.dtors);
+	blocks.resize(p.blocks);
+	cur = p.cur;
+	end = p.end;
+}
+
 static llvm::Value* try_create_implicit_cast(llvm::Value* value, llvm::Type* type)
 {
 	llvm::Type* cur_type = value->getType();
@@ -329,12 +392,13 @@ AST_result AST_namespace::get_id(const std::string& name, bool precise, unsigned
 // AST_context
 AST_function_context::~AST_function_context()
 {
+	auto body_end = lBuilder.GetInsertBlock();		// where the last block of the body left off
 	lBuilder.SetInsertPoint(alloc_block);
 	lBuilder.CreateBr(entry_block);
 
 	function->getBasicBlockList().push_back(return_block);
-	lBuilder.SetInsertPoint(block);
-	lBuilder.CreateBr(return_block);
+	lBuilder.SetInsertPoint(body_end);
+	make_br(return_block);
 
 	lBuilder.SetInsertPoint(return_block);
 	if (function->getReturnType() == void_type)
@@ -343,18 +407,12 @@ AST_function_context::~AST_function_context()
 		lBuilder.CreateRet(lBuilder.CreateLoad(retval, "retval_load"));
 	function->setCallingConv(llvm::CallingConv::C);
 
-	llvm::AttributeSet function_attrs;
-	llvm::SmallVector<llvm::AttributeSet, 4> attrs;
-	llvm::AttributeSet PAS;
-	{
-		llvm::AttrBuilder B;
-		B.addAttribute(llvm::Attribute::NoUnwind);
-		B.addAttribute(llvm::Attribute::NoInline);
-		PAS = llvm::AttributeSet::get(lModule->getContext(), ~0U, B);
-	}
-	attrs.push_back(PAS);
-	function_attrs = llvm::AttributeSet::get(lModule->getContext(), attrs);
-	function->setAttributes(function_attrs);
+	function->addFnAttr(llvm::Attribute::NoUnwind);		// nothing in w throws
+	if (fn_attr.count(is_inline)) function->addFnAttr(llvm::Attribute::AlwaysInline);
+	if (fn_attr.count(is_noinline)) function->addFnAttr(llvm::Attribute::NoInline);
+	if (fn_attr.count(is_cold)) function->addFnAttr(llvm::Attribute::Cold);
+	if (fn_attr.count(is_pure)) function->addFnAttr(llvm::Attribute::ReadOnly);
+	infer_attrs();
 	llvm::verifyFunction(*function);
 	lBuilder.SetInsertPoint(old_block);
 	#ifdef WC_DEBUG
@@ -362,6 +420,37 @@ AST_function_context::~AST_function_context()
 	#endif
 }
 
+void AST_function_context::infer_attrs()
+{
+	if (function->doesNotAccessMemory()) return;
+	bool reads = false;
+	for (auto& B: *function) for (auto& I: B)
+	{
+		if (auto store = llvm::dyn_cast<llvm::StoreInst>(&I))
+		{	// locals live in allocas, storing to them is not seen by the caller
+			if (!llvm::isa<llvm::AllocaInst>(store->getPointerOperand()->stripInBoundsOffsets())) return;
+		}
+		else if (auto load = llvm::dyn_cast<llvm::LoadInst>(&I))
+		{
+			if (!llvm::isa<llvm::AllocaInst>(load->getPointerOperand()->stripInBoundsOffsets())) reads = true;
+		}
+		else if (auto call = llvm::dyn_cast<llvm::CallInst>(&I))
+		{	// a callee is finished before its callers unless it is the function itself
+			auto callee = call->getCalledFunction();
+			if (callee == function) continue;
+			if (!callee || !callee->onlyReadsMemory()) return;
+			if (!callee->doesNotAccessMemory()) reads = true;
+		}
+		else if (I.mayReadOrWriteMemory()) return;
+	}
+	if (reads) function->setOnlyReadsMemory();
+	else
+	{
+		function->removeFnAttr(llvm::Attribute::ReadOnly);		// a pure function may touch nothing
+		function->setDoesNotAccessMemory();
+	}
+}
+
 llvm::Function* template_func_meta::get_function(const std::vector<llvm::Value*>& params, AST_context* context, template_params* ta)
 {
 	if (params.size() != template_func_params.size())
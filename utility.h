@@ -6,6 +6,15 @@
 #include <string>
 #include <initializer_list>
 #include <map>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#endif
 #include <llvm/IR/Verifier.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/IRBuilder.h>
@@ -20,101 +29,174 @@ using pchar = const char*;
 struct attr_type;
 //std::vector<attr_type> attr_list;
 
+// a token is the rule it matched and a slice of the source, it owns nothing
 struct token
 {
-private:
-	using pointer = std::shared_ptr<attr_type>;
 public:
 	token() = default;
-	token(const std::string& n,
-		unsigned line,
-		unsigned column,
-		pchar src_ptr,
-		const pointer& attr_ptr = nullptr):
-		name(n),
-		ln(line),
-		col(column),
-		ptr(src_ptr),
-		attr(attr_ptr)
+	token(int k,
+		unsigned off,
+		unsigned len):
+		kind(k),
+		offset(off),
+		length(len)
 	{}
 	explicit operator bool() const
-		{ return name != ""; }
+		{ return kind >= 0; }
 public:
-	std::string name;
-	unsigned ln;
-	unsigned col;
-	pchar ptr;
-	pointer attr;
+	int kind = -1;			// rule of the lexer, -1 ends the input
+	unsigned offset = 0;	// also the location, see line_table
+	unsigned length = 0;
+};
+
+// line starts of the source being parsed, only scanned when a location is printed
+class line_table
+{
+public:
+	void reset(pchar p, std::size_t n)
+		{ base = p; size = n; starts.clear(); }
+	pchar end() const
+		{ return base + size; }
+	// line and column of an offset, both count from 0
+	void locate(unsigned offset, unsigned& ln, unsigned& col, pchar& line);
+private:
+	void build();
+private:
+	pchar base = nullptr;
+	std::size_t size = 0;
+	std::vector<unsigned> starts;
 };
 
+line_table cur_lines;
+
 struct AST;
 struct err;
 struct gen_node;
 struct term_node;
 struct AST_context;
 class AST_result;
-using sub_nodes = std::vector<AST*>;
+// children of a node, the array lives in the arena of the tree
+struct sub_nodes
+{
+	AST** first = nullptr;
+	unsigned count = 0;
+	AST** begin() const
+		{ return first; }
+	AST** end() const
+		{ return first + count; }
+	unsigned size() const
+		{ return count; }
+	bool empty() const
+		{ return !count; }
+	AST*& operator [] (unsigned i) const
+		{ return first[i]; }
+};
 // AST node base
 
 struct AST
 {
 	friend struct err;
-	sub_nodes sub;
+	friend class parser;		// relinks and moves the kept nodes on reparse
 public:
-	AST(token& T):
-		ln(T.ln),
-		col(T.col),
-		ptr(T.ptr)
+	AST(token& T, unsigned i, sub_nodes s = sub_nodes()):
+		sub_first(s.first),
+		sub_count(s.count),
+		id(i),
+		offset(T.offset)
 	{}
 	virtual AST_result code_gen(AST_context* context) = 0;
-	void append_child(AST* p)
-		{ sub.push_back(p); }
 	AST& operator[](int i)
-		{ return *sub[i]; }
-	void destroy()
-		{ for (auto& n: sub) n->destroy(); delete this; }
+		{ return *sub_first[i]; }
+	sub_nodes sub() const
+		{ return { sub_first, sub_count }; }
+protected:
+	// laid out to fit 32 bytes with the vtable pointer
+	AST** sub_first;
+	unsigned sub_count;
+	unsigned id;		// rule of a gen, symbol of a term
 private:
-	unsigned ln;
-	unsigned col;
-	pchar ptr;
+	unsigned offset;	// in the source
+};
+
+// owns the nodes of a tree and their children, they are released at once
+class AST_arena
+{
+	static const std::size_t block_size = 64 * 1024;
+public:
+	AST_arena() = default;
+	AST_arena(const AST_arena&) = delete;
+	AST_arena& operator = (const AST_arena&) = delete;
+	~AST_arena()
+		{ clear(); }
+public:
+	template <typename T, typename... Args>
+	T* make(Args&&... args)
+	{
+		auto p = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value)
+			dtors.push_back({ p, [](void* q) { static_cast<T*>(q)->~T(); } });
+		return p;
+	}
+	sub_nodes make_sub(unsigned n)
+	{
+		sub_nodes s;
+		s.first = static_cast<AST**>(allocate(n * sizeof(AST*), alignof(AST*)));
+		s.count = n;
+		return s;
+	}
+	// drop every node, the first block is kept for the next tree
+	void clear();
+	// where the next node goes, the nodes made behind it can be dropped
+	struct position
+	{
+		std::size_t blocks, dtors;
+		char* cur;
+		char* end;
+	};
+	position tell() const
+		{ return { blocks.size(), dtors.size(), cur, end }; }
+	void rewind(const position& p);
+private:
+	void* allocate(std::size_t n, std::size_t align);
+private:
+	std::vector<std::unique_ptr<char[]>> blocks;
+	std::size_t first_size = 0;
+	char* cur = nullptr;
+	char* end = nullptr;
+	std::vector<std::pair<void*, void(*)(void*)>> dtors;		// nodes that own memory
 };
 
 AST* cur_node = nullptr;
+// set by a code_gen that keeps nodes to generate them later, such as a template
+bool nodes_kept = false;
 
 struct err:std::logic_error
 {
 	err(const std::string& s, AST& T):
 		std::logic_error(s),
-		ln(T.ln),
-		col(T.col),
-		ptr(T.ptr)
+		offset(T.offset),
+		located(true)
 	{}
 	err(const std::string& s, token& T):
 		std::logic_error(s),
-		ln(T.ln),
-		col(T.col),
-		ptr(T.ptr)
+		offset(T.offset),
+		located(true)
 	{}
 	err(const std::string& s):
 		std::logic_error(s),
-		ln(cur_node?cur_node->ln:0),
-		col(cur_node?cur_node->col:0),
-		ptr(cur_node?cur_node->ptr:nullptr)
+		offset(cur_node?cur_node->offset:0),
+		located(cur_node != nullptr)
 	{}
 	err(const std::string& s,
-		unsigned LN,
-		unsigned COL,
-		pchar PTR):
+		unsigned OFFSET):
 		std::logic_error(s),
-		ln(LN),
-		col(COL),
-		ptr(PTR)
+		offset(OFFSET),
+		located(true)
 	{}
 	virtual void alert() const;
 protected:
-	unsigned ln;
-	unsigned col;
-	pchar ptr;
+	unsigned offset;
+	bool located;
 };
 
 static llvm::Module *lModule = new llvm::Module("LRparser", llvm::getGlobalContext());
@@ -277,7 +359,7 @@ public:
 		template_args(*ta),
 		template_func_params(*params),
 		syntax_node(sn)
-	{}
+	{ nodes_kept = true; }
 	llvm::Function* get_function(const std::vector<llvm::Value*>& params,
 		AST_context* context, template_params* ta = nullptr);
 };
@@ -291,7 +373,7 @@ public:
 	template_class_meta(template_args_type* ta, AST& sn):
 		template_args(*ta),
 		syntax_node(sn)
-	{}
+	{ nodes_kept = true; }
 	llvm::StructType* generate_class(const template_params& params, AST_context* context);
 };
 
@@ -299,6 +381,10 @@ using function_attr = std::set<unsigned>;
 const unsigned is_method = 1;
 const unsigned is_virtual = 2;
 const unsigned is_override = 4;
+const unsigned is_inline = 8;
+const unsigned is_noinline = 16;
+const unsigned is_pure = 32;		// reads memory but writes none
+const unsigned is_cold = 64;
 
 const unsigned is_this = 4;
 const unsigned is_private = 0;		// 00
@@ -1016,10 +1102,11 @@ public:
 		{ return block; }
 	void set_block(llvm::BasicBlock* b)
 		{ get_local_function()->getBasicBlockList().push_back(block = b); activate(); }
+	// a block that already jumped, by a return, break or continue, ends there
 	void make_cond_br(llvm::Value* cond, llvm::BasicBlock* b1, llvm::BasicBlock* b2)
-		{ lBuilder.CreateCondBr(create_implicit_cast(cond, bool_type), b1, b2); }
+		{ if (!lBuilder.GetInsertBlock()->getTerminator()) lBuilder.CreateCondBr(create_implicit_cast(cond, bool_type), b1, b2); }
 	void make_br(llvm::BasicBlock* b)
-		{ lBuilder.CreateBr(b); }
+		{ if (!lBuilder.GetInsertBlock()->getTerminator()) lBuilder.CreateBr(b); }
 	virtual void make_break()
 		{ static_cast<AST_basic_local_context*>(parent)->make_break(); }
 	virtual void make_continue()
@@ -1129,6 +1216,9 @@ class AST_function_context: public AST_basic_local_context
 	llvm::BasicBlock* return_block;
 	llvm::BasicBlock* old_block;
 	llvm::Value* retval;
+	function_attr fn_attr;
+	// mark what the finished body is seen to do to memory
+	void infer_attrs();
 protected:
 	std::string fname;
 	llvm::BasicBlock* get_alloc_block() const override
@@ -1146,6 +1236,7 @@ public:
 		return_block(llvm::BasicBlock::Create(llvm::getGlobalContext(), "return"))
 	{
 		if (name != "") p->add_func(F, name, fnattr);
+		if (fnattr) fn_attr = *fnattr;
 		F->getBasicBlockList().push_back(block);
 		if (F->getReturnType() != void_type)
 		{
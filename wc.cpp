@@ -1,13 +1,46 @@
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/InitializePasses.h>
+#include <llvm/PassRegistry.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#ifdef WC_LLD
+#include <lld/Driver/Driver.h>		// link with the lld library instead of an ld process
+#endif
+#ifdef _WIN32
 #include <windows.h>
 #include <io.h>
+#else
+#include <spawn.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+extern char** environ;
+#endif
 #include "wc.h"
 #include <fstream>
+#include <sstream>
+#ifdef WC_PRECOMPILED_TABLES
+#include "wc_tables.h"		// generated by wcgen
+#endif
 const int exe_format = 0;
 const int llvm_ir_format = 1;
 const int asm_format = 2;
 const int object_format = 3;
 
+#ifdef _WIN32
 int execute_command(char* cmdline)
 {
 	STARTUPINFO si;
@@ -36,28 +69,292 @@ int execute_command(char* cmdline)
 	CloseHandle(pi.hThread);
 	return ret;
 }
+#else
+// start a tool found on PATH with the given stdin and stdout, -1 keeps wc's own
+pid_t spawn_tool(const vector<string>& args, int in = -1, int out = -1)
+{
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	if (in >= 0) posix_spawn_file_actions_adddup2(&actions, in, 0);
+	if (out >= 0) posix_spawn_file_actions_adddup2(&actions, out, 1);
+	vector<char*> argv;
+	for (auto& arg: args) argv.push_back(const_cast<char*>(arg.c_str()));
+	argv.push_back(nullptr);
+	pid_t pid;
+	int error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+	posix_spawn_file_actions_destroy(&actions);
+	if (error) throw err("cannot start " + args[0] + ": " + strerror(error));
+	return pid;
+}
+
+int wait_tool(pid_t pid)
+{
+	int status;
+	while (waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR) return -1;
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// the command lines built here have no quoted arguments
+int execute_command(char* cmdline)
+{
+	vector<string> args;
+	istringstream words(cmdline);
+	for (string word; words >> word; ) args.push_back(word);
+	return wait_tool(spawn_tool(args));
+}
+
+// the backend when llc does the code generation, the module streams into it over a pipe
+// the object of an executable is held in an anonymous memory file until ld reads it
+int llc_pipe(Module& module, int dest_format, const string& output_file_name, unsigned level, const string& cpu,
+	bool function_sections, bool gc_sections, const string& runtime)
+{
+	vector<string> llc = { "llc", "-O" + to_string(level), "-o", dest_format == exe_format ? "-" : output_file_name };
+	if (dest_format != asm_format) llc.push_back("-filetype=obj");
+	if (!cpu.empty()) llc.push_back("-mcpu=" + cpu);
+	if (function_sections) llc.insert(llc.end(), { "-function-sections", "-data-sections" });
+	llc.push_back("-");
+	int object = -1;
+	if (dest_format == exe_format && (object = memfd_create("wc_object", 0)) < 0)
+		throw err("cannot create a memory file for the object");
+	int ir[2];
+	if (pipe2(ir, O_CLOEXEC)) throw err("cannot create a pipe to llc");
+	signal(SIGPIPE, SIG_IGN);		// a failing llc is told by its exit code
+	pid_t pid;
+	try { pid = spawn_tool(llc, ir[0], object); }
+	catch (...) { close(ir[0]); close(ir[1]); if (object >= 0) close(object); throw; }
+	close(ir[0]);
+	{
+		raw_fd_ostream os(ir[1], true);		// llc sees the end when it is closed
+		module.print(os, nullptr);
+		os.close();
+		os.clear_error();
+	}
+	int ret = wait_tool(pid);
+	if (dest_format == exe_format)
+	{
+		vector<string> ld = { "ld", "/dev/fd/" + to_string(object), "-o", output_file_name };
+		if (gc_sections) ld.push_back("--gc-sections");
+		if (!runtime.empty()) ld.push_back(runtime);
+		if (!ret) ret = wait_tool(spawn_tool(ld));
+		close(object);
+	}
+	return ret;
+}
+
+// compile each file in a forked copy of wc, at most jobs of them at once
+// the copies share the parser tables and keep their modules apart
+int run_jobs(const vector<string>& files, unsigned jobs, const std::function<int(const string&)>& compile)
+{
+	int ret = 0;
+	unsigned running = 0;
+	auto wait_job = [&]()
+	{
+		int status;
+		while (wait(&status) < 0)
+			if (errno != EINTR) throw err("lost a job");
+		--running;
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) ret = 1;
+	};
+	for (auto& file: files)
+	{
+		if (running == jobs) wait_job();
+		cout.flush();
+		auto pid = fork();
+		if (pid < 0) throw err("cannot start a job for " + file);
+		if (!pid)
+		{
+			int job_ret = compile(file);
+			cout.flush();
+			_exit(job_ret);
+		}
+		++running;
+	}
+	while (running) wait_job();
+	return ret;
+}
+#endif
+
+// sys::path takes both separators, so a dot in a directory is not a suffix
+string temp(const string& s)
+{
+	SmallString<128> path(sys::path::parent_path(s));
+	sys::path::append(path, "$tmp_output_" + sys::path::filename(s) + "~");
+	return string(path.begin(), path.end());
+}
+
+string change_suffix(const string& s, const string& suffix)
+{
+	SmallString<128> path(s);
+	sys::path::replace_extension(path, suffix);
+	return string(path.begin(), path.end());
+}
+
+// reparse the file on each save and report its syntax errors until killed
+// the code is generated by a run without -watch
+void watch(parser& mparser, const string& file_name)
+{
+	string old_src, src;
+#ifdef _WIN32
+	FILETIME saved = {};
+#else
+	timespec saved = {};
+#endif
+	while (true)
+	{
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA attrs;
+		if (!GetFileAttributesExA(file_name.c_str(), GetFileExInfoStandard, &attrs) ||
+			!CompareFileTime(&attrs.ftLastWriteTime, &saved))
+		{
+			Sleep(50);
+			continue;
+		}
+		saved = attrs.ftLastWriteTime;
+#else
+		struct stat attrs;
+		if (stat(file_name.c_str(), &attrs) ||
+			(attrs.st_mtim.tv_sec == saved.tv_sec && attrs.st_mtim.tv_nsec == saved.tv_nsec))
+		{
+			usleep(50000);
+			continue;
+		}
+		saved = attrs.st_mtim;
+#endif
+		ifstream is(file_name, ios::binary);
+		src.assign(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+		// one edit from the first to the last changed char
+		unsigned begin = 0, old_end = old_src.size(), end = src.size();
+		while (begin != old_end && begin != end && old_src[begin] == src[begin]) ++begin;
+		while (old_end != begin && end != begin && old_src[old_end - 1] == src[end - 1]) --old_end, --end;
+		try
+		{
+			mparser.reparse(src.data(), src.size(), { { begin, old_end, end - begin } });
+			cerr << "wc: " << file_name << ": no syntax errors" << endl;
+		}
+		catch (const err& e)
+		{						// poly
+			e.alert();
+			cerr << endl;
+		}
+		old_src.swap(src);
+	}
+}
+
+// the backend for a triple, the host if none, and a cpu of it, generic if none
+// the module is laid out for it so the middle end sees the real target
+// nullptr if this wc is built without that target, llc may still have it
+TargetMachine* target_machine(Module& module, const string& triple, const string& cpu, unsigned level,
+	bool function_sections)
+{
+	InitializeAllTargetInfos();
+	InitializeAllTargets();
+	InitializeAllTargetMCs();
+	InitializeAllAsmPrinters();
+	auto target_triple = triple.empty() ? sys::getDefaultTargetTriple() : triple;
+	string error;
+	auto target = TargetRegistry::lookupTarget(target_triple, error);
+	if (!target) return nullptr;
+	static const CodeGenOpt::Level levels[] =
+		{ CodeGenOpt::None, CodeGenOpt::Less, CodeGenOpt::Default, CodeGenOpt::Aggressive };
+	TargetOptions options;
+	options.FunctionSections = options.DataSections = function_sections;	// so the linker can drop them
+	auto machine = target->createTargetMachine(target_triple, cpu.empty() ? "generic" : cpu, "",
+		options, Reloc::Default, CodeModel::Default, levels[level]);
+	if (!machine) throw err("no target machine for " + target_triple);
+	module.setTargetTriple(target_triple);
+	module.setDataLayout(machine->createDataLayout());
+	return machine;
+}
+
+// write assembly or an object file straight from the module
+void emit(Module& module, TargetMachine& machine, raw_pwrite_stream& os, TargetMachine::CodeGenFileType type)
+{
+	legacy::PassManager codegen_passes;
+	if (machine.addPassesToEmitFile(codegen_passes, os, type))
+		throw err("target cannot emit this type of file");
+	codegen_passes.run(module);
+}
 
-string temp(string s)
+void emit(Module& module, TargetMachine& machine, const string& file_name, TargetMachine::CodeGenFileType type)
 {
-	s += "~";
-	auto str_begin = s.c_str();
-	auto p = str_begin + s.length();
-	while (p != str_begin && *p != '\\') --p;
-	if (*p == '\\') ++p;
-	s.insert(p - str_begin, "$tmp_output_");
-	return s;
+	std::error_code ec;
+	raw_fd_ostream os(file_name, ec, sys::fs::F_None);
+	if (ec) throw err("cannot open output file " + file_name + ": " + ec.message());
+	emit(module, machine, os, type);
 }
 
-string change_suffix(string s, const string& suffix)
+// link an object into an executable with ld, or in this process with lld
+// the runtime, a static archive, is searched after the object
+int link_executable(const string& object_file_name, const string& output_file_name, bool in_process,
+	bool gc_sections, const string& runtime)
 {
-	auto str_begin = s.c_str();
-	auto p = str_begin + s.length();
-	while (p != str_begin && *p != '.' && *p != '\\') --p;
-	if (*p == '.')
+#ifdef WC_LLD
+	if (in_process)
+	{	// lld 3.8 reports errors and exits by itself, it returns only on success
+		std::vector<const char*> args = { "ld.lld", object_file_name.c_str(), "-o", output_file_name.c_str() };
+		if (gc_sections) args.push_back("--gc-sections");
+		if (!runtime.empty()) args.push_back(runtime.c_str());
+		lld::elf2::link(args);
+		return 0;
+	}
+#endif
+	return execute_command(const_cast<char*>((
+			"ld " + object_file_name + " -o" + output_file_name + (gc_sections ? " --gc-sections" : "") +
+			(runtime.empty() ? "" : " " + runtime)
+		).c_str()));
+}
+
+// run the middle end on the module, the pipeline of an -O level like clang builds it
+// or else the passes named in a -passes= list, in order
+void optimize(Module& module, unsigned level, const string& passes, TargetMachine* machine)
+{
+	string problems;
+	raw_string_ostream os(problems);
+	if (verifyModule(module, &os)) throw err("invalid module generated: " + os.str());
+	auto& registry = *PassRegistry::getPassRegistry();
+	initializeCore(registry);
+	initializeAnalysis(registry);
+	initializeTransformUtils(registry);
+	initializeScalarOpts(registry);
+	initializeInstCombine(registry);
+	initializeIPO(registry);
+	initializeVectorization(registry);
+	legacy::PassManager module_passes;
+	if (machine) module_passes.add(createTargetTransformInfoWrapperPass(machine->getTargetIRAnalysis()));
+	if (!passes.empty())
 	{
-		s.resize(p - str_begin);
+		for (string::size_type begin = 0, end; begin < passes.size(); begin = end + 1)
+		{
+			end = min(passes.find(',', begin), passes.size());
+			auto name = passes.substr(begin, end - begin);
+			auto info = registry.getPassInfo(name);
+			if (!info || !info->getNormalCtor()) throw err("unknown pass: " + name);
+			module_passes.add(info->createPass());
+		}
+		module_passes.add(createVerifierPass());
+		module_passes.run(module);
+		return;
+	}
+	if (!level)
+	{	// inline functions are still inlined at -O0, as clang does
+		module_passes.add(createAlwaysInlinerPass());
+		module_passes.run(module);
+		return;
 	}
-	return s + suffix;
+	PassManagerBuilder builder;
+	builder.OptLevel = level;
+	builder.Inliner = level > 1 ? createFunctionInliningPass(level, 0) : createAlwaysInlinerPass();
+	builder.LoopVectorize = level > 1;
+	builder.SLPVectorize = level > 1;
+	legacy::FunctionPassManager function_passes(&module);
+	if (machine) function_passes.add(createTargetTransformInfoWrapperPass(machine->getTargetIRAnalysis()));
+	builder.populateFunctionPassManager(function_passes);
+	builder.populateModulePassManager(module_passes);
+	function_passes.doInitialization();
+	for (auto& f: module) function_passes.run(f);
+	function_passes.doFinalization();
+	module_passes.run(module);
 }
 
 int main(int argc, char *argv[])
@@ -75,102 +372,203 @@ int main(int argc, char *argv[])
 		char** const argv;
 	} params(argc, argv);
 
-	string input_file_name;
-	string output_file_name;
+	vector<string> input_file_names;
+	string output_option;
 	string opt_str;
+	unsigned opt_level = 0;
+	string passes;
+	string target_triple;
+	string target_cpu;
+	bool external_llc = false;
+	bool use_lld = false;
+	bool gc_sections = false;
+	bool function_sections = false;
+	string runtime;
 	int dest_format = 0;
+	unsigned lex_threads = 1;
+	unsigned jobs = 1;
+	bool watch_mode = false;
+	bool streaming = false;
 	using option_callback_type = map<string, std::function<void()>>;
 	using callback = option_callback_type::value_type;
 	option_callback_type option_callback =
 	{
-		callback("-o", [&](){ params.next(); output_file_name = params.current(); }),
+		callback("-o", [&](){ params.next(); output_option = params.current(); }),
 		callback("-s", [&](){ dest_format = asm_format; }),
 		callback("-llvm", [&](){ dest_format = llvm_ir_format; }),
 		callback("-obj", [&](){ dest_format = object_format; }),
-		callback("-O", [&](){ opt_str = " -O1 "; }),
-		callback("-O1", [&](){ opt_str = " -O1 "; }),
-		callback("-O2", [&](){ opt_str = " -O2 "; }),
-		callback("-O3", [&](){ opt_str = " -O3 "; }),
+		callback("-O", [&](){ opt_str = " -O1 "; opt_level = 1; }),
+		callback("-O0", [&](){ opt_str = " -O0 "; opt_level = 0; }),
+		callback("-O1", [&](){ opt_str = " -O1 "; opt_level = 1; }),
+		callback("-O2", [&](){ opt_str = " -O2 "; opt_level = 2; }),
+		callback("-O3", [&](){ opt_str = " -O3 "; opt_level = 3; }),
+		callback("-lex-threads", [&](){ params.next(); lex_threads = strtoul(params.current(), nullptr, 10);
+			if (!lex_threads) lex_threads = std::thread::hardware_concurrency(); }),
+		callback("-j", [&](){ params.next(); jobs = strtoul(params.current(), nullptr, 10);
+			if (!jobs) jobs = max(1u, std::thread::hardware_concurrency()); }),
+		callback("-watch", [&](){ watch_mode = true; }),
+		callback("-stream", [&](){ streaming = true; }),
+		callback("-target", [&](){ params.next(); target_triple = params.current(); }),
+		callback("-mcpu", [&](){ params.next(); target_cpu = params.current(); }),
+		callback("-llc", [&](){ external_llc = true; }),
+		callback("-lld", [&](){
+#ifndef WC_LLD
+			throw err("this wc is built without lld, define WC_LLD and link lldELF2 to use -lld");
+#endif
+			use_lld = true; }),
+		callback("-gc-sections", [&](){ gc_sections = true; }),
+		callback("-function-sections", [&](){ function_sections = true; }),
+		callback("-runtime", [&](){ params.next(); runtime = params.current(); }),
 	};
 
 	try
 	{
+#ifdef WC_PRECOMPILED_TABLES
+		parser mparser(mlex_rules, mparse_rules, mexpr_rules, rep_list, wc_tables);
+#else
 		parser mparser(mlex_rules, mparse_rules, mexpr_rules, rep_list);
+#endif
 		while (!params.empty())
 		{
 			auto& fcallback = option_callback[params.current()];
 			if (fcallback) fcallback();
+			else if (!strncmp(params.current(), "-passes=", 8)) passes = params.current() + 8;
 			else
 			{
 				if (!access(params.current(), 0))	// if we can read from this file
 				{
-					input_file_name = params.current();
+					input_file_names.push_back(params.current());
 				}
 				else throw err(string("unknown compiler option: ") + params.current());
 			}
 			params.next();
 		}
-		if (input_file_name == "") throw err("no input file");
-		if (output_file_name == "")
+		if (input_file_names.empty()) throw err("no input file");
+		if (input_file_names.size() > 1 && output_option != "")
+			throw err("-o names the output of a single input file");
+		mparser.set_lex_threads(lex_threads);
+		mparser.set_streaming(streaming);
+		if (watch_mode) watch(mparser, input_file_names[0]);
+		auto compile = [&](const string& input_file_name)->int
 		{
-			string suffix;
-			switch (dest_format)
+			auto output_file_name = output_option;
+			if (output_file_name == "")
 			{
-			case exe_format: suffix = ".exe"; break;
-			case llvm_ir_format: suffix = ".ll"; break;
-			case asm_format: suffix = ".s"; break;
-			case object_format: suffix = ".o"; break;
+				string suffix;
+				switch (dest_format)
+				{
+#ifdef _WIN32
+				case exe_format: suffix = ".exe"; break;
+#else
+				case exe_format: suffix = ""; break;
+#endif
+				case llvm_ir_format: suffix = ".ll"; break;
+				case asm_format: suffix = ".s"; break;
+				case object_format: suffix = ".o"; break;
+				}
+				output_file_name = change_suffix(input_file_name, suffix);
 			}
-			output_file_name = change_suffix(input_file_name, suffix);
-		}
 
-		ifstream is(input_file_name);
-		string src, dest;
-		getline(is, src, static_cast<char>(EOF));
-		is.close();
-		try
-		{
-			mparser.parse(src.c_str());
-			raw_string_ostream los(dest);
-			lModule->print(los, nullptr);
-
-			string tmp_file_name = dest_format == llvm_ir_format ? output_file_name : temp(output_file_name);
-			ofstream os(tmp_file_name);
-			os << dest;
-			os.close();
-			int ret;
-			switch (dest_format)
+			file_map src;		// the lexer reads the mapping in place
+			string dest;
+			try
 			{
-			case llvm_ir_format: return 0;
-			case asm_format:
-				ret = execute_command(const_cast<char*>((
-						"llc -o " + output_file_name + opt_str + " " + tmp_file_name
-					).c_str()));
-				remove(tmp_file_name.c_str());
-				return ret;
-			case object_format:
-				ret = execute_command(const_cast<char*>((
-						"llc -filetype=obj -o " + output_file_name + opt_str + " " + tmp_file_name
-					).c_str()));
-				remove(tmp_file_name.c_str());
-				return ret;
-			case exe_format:
-				ret = execute_command(const_cast<char*>((
-						"llc -filetype=obj -o " + temp(change_suffix(output_file_name, ".o")) + opt_str + " " + tmp_file_name
-					).c_str()));
-				remove(tmp_file_name.c_str());
-				if (ret) return ret;
-				ret = execute_command(const_cast<char*>((
-						"ld " + temp(change_suffix(output_file_name, ".o")) + " -o" + output_file_name
-					).c_str()));
-				remove(temp(change_suffix(output_file_name, ".o")).c_str());
-				return ret;
+				if (!src.open(input_file_name) && ifstream(input_file_name).peek() != EOF)
+					throw err("cannot map input file: " + input_file_name);
+				mparser.parse(src.data(), src.size());
+				std::unique_ptr<TargetMachine> machine;
+				if (!external_llc)
+					machine.reset(target_machine(*lModule, target_triple, target_cpu, opt_level, function_sections));
+				if (!machine && target_triple != "") lModule->setTargetTriple(target_triple);	// for llc
+				optimize(*lModule, opt_level, passes, machine.get());
+				if (machine) switch (dest_format)
+				{
+				case asm_format:
+					emit(*lModule, *machine, output_file_name, TargetMachine::CGFT_AssemblyFile);
+					return 0;
+				case object_format:
+					emit(*lModule, *machine, output_file_name, TargetMachine::CGFT_ObjectFile);
+					return 0;
+				case exe_format:
+				{
+#ifdef _WIN32
+					auto object_file_name = temp(change_suffix(output_file_name, ".o"));
+					emit(*lModule, *machine, object_file_name, TargetMachine::CGFT_ObjectFile);
+					int ret = link_executable(object_file_name, output_file_name, use_lld, gc_sections, runtime);
+					remove(object_file_name.c_str());
+#else
+					// the object is held in an anonymous memory file, the linker reads it by its /dev/fd name
+					int object = memfd_create("wc_object", 0);
+					if (object < 0) throw err("cannot create a memory file for the object");
+					int ret;
+					try
+					{
+						raw_fd_ostream os(object, false);
+						emit(*lModule, *machine, os, TargetMachine::CGFT_ObjectFile);
+						os.flush();
+						ret = link_executable("/dev/fd/" + to_string(object), output_file_name, use_lld, gc_sections,
+							runtime);
+					}
+					catch (...) { close(object); throw; }
+					close(object);
+#endif
+					return ret;
+				}
+				}
+#ifndef _WIN32
+				if (dest_format != llvm_ir_format)
+					return llc_pipe(*lModule, dest_format, output_file_name, opt_level, target_cpu, function_sections,
+						gc_sections, runtime);
+#endif
+				if (target_cpu != "") opt_str += " -mcpu=" + target_cpu + " ";
+				if (function_sections) opt_str += " -function-sections -data-sections ";
+				raw_string_ostream los(dest);
+				lModule->print(los, nullptr);
+
+				string tmp_file_name = dest_format == llvm_ir_format ? output_file_name : temp(output_file_name);
+				ofstream os(tmp_file_name);
+				os << dest;
+				os.close();
+				int ret;
+				switch (dest_format)
+				{
+				case llvm_ir_format: return 0;
+				case asm_format:
+					ret = execute_command(const_cast<char*>((
+							"llc -o " + output_file_name + opt_str + " " + tmp_file_name
+						).c_str()));
+					remove(tmp_file_name.c_str());
+					return ret;
+				case object_format:
+					ret = execute_command(const_cast<char*>((
+							"llc -filetype=obj -o " + output_file_name + opt_str + " " + tmp_file_name
+						).c_str()));
+					remove(tmp_file_name.c_str());
+					return ret;
+				case exe_format:
+					ret = execute_command(const_cast<char*>((
+							"llc -filetype=obj -o " + temp(change_suffix(output_file_name, ".o")) + opt_str + " " + tmp_file_name
+						).c_str()));
+					remove(tmp_file_name.c_str());
+					if (ret) return ret;
+					ret = link_executable(temp(change_suffix(output_file_name, ".o")), output_file_name, use_lld, gc_sections,
+						runtime);
+					remove(temp(change_suffix(output_file_name, ".o")).c_str());
+					return ret;
+				}
 			}
-		}
-		catch (const err& e)
-		{						// poly
-			e.alert();
-		}
+			catch (const err& e)
+			{						// poly
+				e.alert();
+			}
+			return 1;
+		};
+		if (input_file_names.size() == 1) return compile(input_file_names[0]);
+#ifdef _WIN32
+		throw err("several input files are compiled by the posix driver only");
+#else
+		return run_jobs(input_file_names, jobs, compile);
+#endif
 	}
 	catch (const err& e)		// poly
 	{
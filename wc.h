@@ -31,6 +31,10 @@ lexer::init_rules mlex_rules =
 		{ "as", "as", {word, no_attr} },
 		{ "virtual", "virtual", {word, no_attr} },
 		{ "override", "override", {word, no_attr} },
+		{ "inline", "inline", {word, no_attr} },
+		{ "noinline", "noinline", {word, no_attr} },
+		{ "pure", "pure", {word, no_attr} },
+		{ "cold", "cold", {word, no_attr} },
 		{ "switch", "switch", {word, no_attr} },
 		{ "case", "case", {word, no_attr} },
 		{ "default", "default", {word, no_attr} },
@@ -69,36 +73,36 @@ lexer::init_rules mlex_rules =
 	{
 		{ "Dec", [](term_node& T, AST_context*){
 			int val;
-			if (sscanf(T.data.attr->value.c_str(), "%d", &val) == 1)
+			if (sscanf(T.attr->value.c_str(), "%d", &val) == 1)
 				return AST_result(lBuilder.getInt32(val), false);
-			throw err("invalid integer literal: ", T.data);
+			throw err("invalid integer literal: ", T);
 		}},
 		{ "Hex", [](term_node& T, AST_context*){
 			int val;
-			if (sscanf(T.data.attr->value.c_str(), "%x", &val) == 1)
+			if (sscanf(T.attr->value.c_str(), "%x", &val) == 1)
 				return AST_result(lBuilder.getInt32(val), false);
-			throw err("invalid integer literal: ", T.data);
+			throw err("invalid integer literal: ", T);
 		}},
 		{ "Oct", [](term_node& T, AST_context*){
 			int val;
-			if (sscanf(T.data.attr->value.c_str(), "%o", &val) == 1)
+			if (sscanf(T.attr->value.c_str(), "%o", &val) == 1)
 				return AST_result(lBuilder.getInt32(val), false);
-			throw err("invalid integer literal: ", T.data);
+			throw err("invalid integer literal: ", T);
 		}},
 		{ "Float", [](term_node& T, AST_context*){
 			double val;
-			if (sscanf(T.data.attr->value.c_str(), "%lf", &val) == 1)
+			if (sscanf(T.attr->value.c_str(), "%lf", &val) == 1)
 				return AST_result(ConstantFP::get(float_type, val), false);
-			throw err("invalid float literal: ", T.data);
+			throw err("invalid float literal: ", T);
 		}},
 		{ "Scientific", [](term_node& T, AST_context*){
 			double val;
-			if (sscanf(T.data.attr->value.c_str(), "%lf", &val) == 1)
+			if (sscanf(T.attr->value.c_str(), "%lf", &val) == 1)
 				return AST_result(ConstantFP::get(float_type, val), false);
-			throw err("invalid float literal: ", T.data);
+			throw err("invalid float literal: ", T);
 		}},
 		{ "Char", [](term_node& T, AST_context*){
-			auto src = T.data.attr->value.c_str() + 1;
+			auto src = T.attr->value.c_str() + 1;
 			if (*src != '\\') return AST_result(lBuilder.getInt8(*src), false);
 			int src_char;
 			if (*++src == 'x' || *src == 'X')
@@ -110,7 +114,7 @@ lexer::init_rules mlex_rules =
 			return AST_result(lBuilder.getInt8(src_char), false);
 		}},
 		{ "Id", [](term_node& T, AST_context* context){
-			return context->get_id(T.data.attr->value);
+			return context->get_id(T.attr->value);
 		}},
 		{ "continue", [](term_node&, AST_context* context){
 			static_cast<AST_local_context*>(context)->make_continue();
@@ -276,7 +280,7 @@ parser::expr_init_rules mexpr_rules =
 
 			local_context->set_block(else_block);
 			auto else_value = syntax_node[2].code_gen(context).get_as<ltype::rvalue>();
-			then_block = local_context->get_block();
+			else_block = local_context->get_block();
 			local_context->make_br(merge_block);
 
 			local_context->set_block(merge_block);
@@ -654,7 +658,7 @@ parser::expr_init_rules mexpr_rules =
 		{ "% . %Id", left_asl, [](gen_node& syntax_node, AST_context* context){
 			auto struct_inst = syntax_node[0].code_gen(context).get_as<ltype::wstruct>();
 			auto struct_namespace = context->get_namespace(struct_inst);
-			auto& name = static_cast<term_node&>(syntax_node[1]).data.attr->value;
+			auto& name = static_cast<term_node&>(syntax_node[1]).attr->value;
 			auto ret = struct_namespace->get_id(name, true);
 			struct_namespace->selected.pop();
 			return ret;
@@ -667,7 +671,7 @@ parser::expr_init_rules mexpr_rules =
 			if (!static_cast<PointerType*>(struct_inst->getType())->getElementType()->isStructTy())
 				throw err("target isnot struct pointer");
 			auto struct_namespace = context->get_namespace(struct_inst);
-			auto& name = static_cast<term_node&>(syntax_node[1]).data.attr->value;
+			auto& name = static_cast<term_node&>(syntax_node[1]).attr->value;
 			auto map = reinterpret_cast<overload_map_type*>(
 				struct_namespace->get_id(name, true).get_as<ltype::overload>());
 			struct_namespace->selected.pop();
@@ -694,7 +698,7 @@ parser::expr_init_rules mexpr_rules =
 			if (!static_cast<PointerType*>(struct_inst->getType())->getElementType()->isStructTy())
 				throw err("target isnot struct pointer");
 			auto struct_namespace = context->get_namespace(struct_inst);
-			auto& name = static_cast<term_node&>(syntax_node[1]).data.attr->value;
+			auto& name = static_cast<term_node&>(syntax_node[1]).attr->value;
 			auto ret = struct_namespace->get_id(name, true);
 			struct_namespace->selected.pop();
 			return ret;
@@ -702,10 +706,41 @@ parser::expr_init_rules mexpr_rules =
 	},
 };
 
+// Type Id ( FunctionParams ) { Block } from syntax_node[first] on, with or without attributes before it
+AST_result function_definition(gen_node& syntax_node, AST_context* context, unsigned first, function_attr* fnattr)
+{
+	context->collect_param_name = true;
+	context->function_param_name.resize(0);
+	auto name = static_cast<term_node&>(syntax_node[first + 1]).attr->value;
+	auto base_type = syntax_node[first].code_gen(context).get_type();
+	if (base_type->isArrayTy())
+		throw err("function cannot return an array");
+	if (base_type->isFunctionTy())
+		throw err("function cannot return a function");
+
+	auto params = syntax_node[first + 2].code_gen(context).get_data<function_params>();
+	auto type = FunctionType::get(base_type, *params, false);	// cannot return an array
+	type_names[type] = type_names[base_type] + "(";
+	if (params->size())
+	{
+		type_names[type] += type_names[(*params)[0]];
+		for (auto itr = params->begin() + 1; itr != params->end(); ++itr)
+			type_names[type] += ", " + type_names[*itr];
+	}
+	type_names[type] += ")";
+	delete params;
+
+	Function* F = Function::Create(type, Function::ExternalLinkage, name, lModule);
+	AST_function_context new_context(context, F, name, fnattr);
+	new_context.register_args();
+	syntax_node[first + 3].code_gen(&new_context);
+	return AST_result();
+}
+
 parser::init_rules mparse_rules =
 {	// Basic
 	{ "S", {
-		{ "S GlobalItem", parser::expand },
+		{ "S GlobalItem", parser::expand, {}, true },
 		{ "", parser::empty }
 	}},
 	{ "GlobalItem", {
@@ -718,10 +753,13 @@ parser::init_rules mparse_rules =
 	{ "InitList", {
 		{ "InitList , InitItem", [](gen_node& syntax_node, AST_context* context){
 			auto vec = reinterpret_cast<init_vec*>(syntax_node[0].code_gen(context).get_as<ltype::init_list>());
-			auto data = reinterpret_cast<init_vec*>(syntax_node[1].code_gen(context).get_as<ltype::init_list>());
-			for (auto& elem: *data) vec->push_back(elem);
+			for (unsigned i = 1; i != syntax_node.sub().size(); ++i)
+			{
+				auto data = reinterpret_cast<init_vec*>(syntax_node[i].code_gen(context).get_as<ltype::init_list>());
+				for (auto& elem: *data) vec->push_back(elem);
+			}
 			return AST_result(vec);
-		}},
+		}, {}, true },
 		{ "InitItem", [](gen_node& syntax_node, AST_context* context){
 			auto vec = new init_vec;
 			auto data = reinterpret_cast<init_vec*>(syntax_node[0].code_gen(context).get_as<ltype::init_list>());
@@ -955,7 +993,7 @@ parser::init_rules mparse_rules =
 		{ ";", parser::empty }
 	}},
 	{ "Stmts", {
-		{ "Stmts Stmt", parser::expand },
+		{ "Stmts Stmt", parser::expand, {}, true },
 		{ "", parser::empty }
 	}},
 	{ "StmtBlock", {
@@ -971,7 +1009,7 @@ parser::init_rules mparse_rules =
 		}}
 	}},
 	{ "Block", {
-		{ "Block Stmt", parser::expand },
+		{ "Block Stmt", parser::expand, {}, true },
 		{ "", parser::empty }
 	}},
 
@@ -1178,7 +1216,7 @@ parser::init_rules mparse_rules =
 		{ "bool", parser::forward },
 		{ "void", parser::forward },
 		{ "IdType", [](gen_node& syntax_node, AST_context* context){
-			return context->get_type(static_cast<term_node&>(syntax_node[0]).data.attr->value);
+			return context->get_type(static_cast<term_node&>(syntax_node[0]).attr->value);
 		}},
 		/*{ "fn ( FunctionParams ) FunctionRetType", [](gen_node& syntax_node, AST_context* context){
 			auto base_type = syntax_node[1].code_gen(context).get_type();
@@ -1224,9 +1262,10 @@ parser::init_rules mparse_rules =
 	{ "FunctionParamList", {
 		{ "FunctionParamList , FunctionParam", [](gen_node& syntax_node, AST_context* context){
 			function_params* p = syntax_node[0].code_gen(context).get_data<function_params>();
-			p->push_back(syntax_node[1].code_gen(context).get_type());
+			for (unsigned i = 1; i != syntax_node.sub().size(); ++i)
+				p->push_back(syntax_node[i].code_gen(context).get_type());
 			return AST_result(p);
-		}},
+		}, {}, true },
 		{ "FunctionParam", [](gen_node& syntax_node, AST_context* context){
 			function_params* p = new function_params;
 			p->push_back(syntax_node[0].code_gen(context).get_type());
@@ -1243,7 +1282,7 @@ parser::init_rules mparse_rules =
 				if (type->isFunctionTy() || type->isVoidTy())
 					throw err("type " + type_names[type] + " is invalid argument type");
 			if (context->collect_param_name = bak_collect)
-				context->function_param_name.push_back(static_cast<term_node&>(syntax_node[1]).data.attr->value);
+				context->function_param_name.push_back(static_cast<term_node&>(syntax_node[1]).attr->value);
 			return AST_result(type);
 		}},
 		{ "Type", [](gen_node& syntax_node, AST_context* context){
@@ -1261,45 +1300,51 @@ parser::init_rules mparse_rules =
 	}},
 	{ "Function", {
 		{ "Type Id ( FunctionParams ) { Block }", [](gen_node& syntax_node, AST_context* context){
-			context->collect_param_name = true;
-			context->function_param_name.resize(0);
-			auto name = static_cast<term_node&>(syntax_node[1]).data.attr->value;
-			auto base_type = syntax_node[0].code_gen(context).get_type();			//syntax_node[0].code_gen(context).get_type();
-			if (base_type->isArrayTy())
-				throw err("function cannot return an array");
-			if (base_type->isFunctionTy())
-				throw err("function cannot return a function");
-			
-			auto params = syntax_node[2].code_gen(context).get_data<function_params>();
-			auto type = FunctionType::get(base_type, *params, false);	// cannot return an array
-			type_names[type] = type_names[base_type] + "(";
-			if (params->size())
-			{
-				type_names[type] += type_names[(*params)[0]];
-				for (auto itr = params->begin() + 1; itr != params->end(); ++itr)
-					type_names[type] += ", " + type_names[*itr];
-			}
-			type_names[type] += ")";
-			delete params;
-
-			Function* F = Function::Create(type, Function::ExternalLinkage, name, lModule);
-			AST_function_context new_context(context, F, name);
-			new_context.register_args();
-			syntax_node[3].code_gen(&new_context);
-			return AST_result();
+			return function_definition(syntax_node, context, 0, nullptr);
 		},
 		{	//$ parser callback
 			{ 6, parser::enter_block },
 			{ 8, parser::leave_block }
+		}},
+		{ "FunctionAttr Type Id ( FunctionParams ) { Block }", [](gen_node& syntax_node, AST_context* context){
+			unique_ptr<function_attr> fnattr(syntax_node[0].code_gen(context).get_data<function_attr>());
+			return function_definition(syntax_node, context, 1, fnattr.get());
+		},
+		{	//$ parser callback
+			{ 7, parser::enter_block },
+			{ 9, parser::leave_block }
+		}}
+	}},
+
+	{ "FunctionAttr", {
+		{ "FunctionAttr FunctionAttrElem", [](gen_node& syntax_node, AST_context* context){
+			unique_ptr<function_attr> fnattr(syntax_node[0].code_gen(context).get_data<function_attr>());
+			auto attr = syntax_node[1].code_gen(context).get_attr();
+			if (fnattr->count(attr)) throw err("function attribute redeclared");
+			fnattr->insert(attr);
+			if (fnattr->count(is_inline) && fnattr->count(is_noinline))
+				throw err("function cannot be both inline and noinline");
+			return AST_result(fnattr.release());
+		}},
+		{ "FunctionAttrElem", [](gen_node& syntax_node, AST_context* context){
+			auto fnattr = new function_attr;
+			fnattr->insert(syntax_node[0].code_gen(context).get_attr());
+			return AST_result(fnattr);
 		}}
 	}},
+	{ "FunctionAttrElem", {
+		{ "inline", parser::attribute<is_inline> },
+		{ "noinline", parser::attribute<is_noinline> },
+		{ "pure", parser::attribute<is_pure> },
+		{ "cold", parser::attribute<is_cold> },
+	}},
 
 	// Template
 	{ "TemplateFunction", {
 		{ "Type Id ( FunctionParams ) { Block }", [](gen_node& syntax_node, AST_context* context){
 			context->collect_param_name = true;
 			context->function_param_name.resize(0);
-			auto name = static_cast<term_node&>(syntax_node[1]).data.attr->value;
+			auto name = static_cast<term_node&>(syntax_node[1]).attr->value;
 			auto base_type = syntax_node[0].code_gen(context).get_type();
 			if (base_type->isArrayTy())
 				throw err("function cannot return an array");
@@ -1350,7 +1395,7 @@ parser::init_rules mparse_rules =
 			struct_context->verify_vmethod();
 
 			syntax_node[2].code_gen(struct_context);
-			struct_context->finish_struct(static_cast<term_node&>(syntax_node[0]).data.attr->value);
+			struct_context->finish_struct(static_cast<term_node&>(syntax_node[0]).attr->value);
 
 			syntax_node[2].code_gen(struct_context);
 			struct_context->verify();
@@ -1379,7 +1424,7 @@ parser::init_rules mparse_rules =
 			auto ta = syntax_node[0].code_gen(context).get_data<template_args_type>();
 			context->add_template_class(ta, static_cast<term_node&>(
 					static_cast<gen_node&>(syntax_node[1])[0]
-				).data.attr->value, syntax_node[1]);
+				).attr->value, syntax_node[1]);
 			delete ta;
 			return AST_result();
 		}}
@@ -1402,7 +1447,7 @@ parser::init_rules mparse_rules =
 			)[0].code_gen(&template_context).get_data<function_params>();
 			context->add_template_func(ta, params, static_cast<term_node&>(
 					static_cast<gen_node&>(syntax_node[1])[1]
-				).data.attr->value, syntax_node[1]);
+				).attr->value, syntax_node[1]);
 			delete ta;
 			delete params;
 			return AST_result();
@@ -1427,7 +1472,7 @@ parser::init_rules mparse_rules =
 	{ "TemplateParamItem", {
 		{ "type Id", [](gen_node& syntax_node, AST_context* context){
 			return AST_result(new pair<Type*, std::string>(nullptr,
-					static_cast<term_node&>(syntax_node[0]).data.attr->value));
+					static_cast<term_node&>(syntax_node[0]).attr->value));
 		},
 		{	//$ parser callback
 			{ 2, parser::register_type }
@@ -1435,7 +1480,7 @@ parser::init_rules mparse_rules =
 		{ "Type Id", [](gen_node& syntax_node, AST_context* context){
 			return AST_result(new pair<Type*, std::string>(
 					syntax_node[0].code_gen(context).get_type(),
-					static_cast<term_node&>(syntax_node[1]).data.attr->value));
+					static_cast<term_node&>(syntax_node[1]).attr->value));
 		}},
 	}},
 	{ "TemplateFunctionCall", {					// TODO remove this
@@ -1468,7 +1513,7 @@ parser::init_rules mparse_rules =
 		{ "TypeDefine, Id = Type", [](gen_node& syntax_node, AST_context* context){
 			syntax_node[0].code_gen(context);
 			auto type = syntax_node[2].code_gen(context).get_type();
-			context->add_type(type, static_cast<term_node&>(syntax_node[1]).data.attr->value);
+			context->add_type(type, static_cast<term_node&>(syntax_node[1]).attr->value);
 			return AST_result();
 		},
 		{	//$ parser callback
@@ -1476,7 +1521,7 @@ parser::init_rules mparse_rules =
 		}},
 		{ "type Id = Type", [](gen_node& syntax_node, AST_context* context){
 			auto type = syntax_node[1].code_gen(context).get_type();
-			context->add_type(type, static_cast<term_node&>(syntax_node[0]).data.attr->value);
+			context->add_type(type, static_cast<term_node&>(syntax_node[0]).attr->value);
 			return AST_result();
 		},
 		{	//$ parser callback
@@ -1497,7 +1542,7 @@ parser::init_rules mparse_rules =
 				}
 			}
 			if (!type && !init) throw err("let clause must be initialized");
-			context->alloc_var(type ? type : init->getType(), static_cast<term_node&>(syntax_node[1]).data.attr->value, init);
+			context->alloc_var(type ? type : init->getType(), static_cast<term_node&>(syntax_node[1]).attr->value, init);
 			return AST_result(type);
 		}},
 		{ "Type Id GlobalInitExpr", [](gen_node& syntax_node, AST_context* context){
@@ -1512,7 +1557,7 @@ parser::init_rules mparse_rules =
 				case 1: init = data.first; break;
 				}
 			}
-			context->alloc_var(type, static_cast<term_node&>(syntax_node[1]).data.attr->value, init);
+			context->alloc_var(type, static_cast<term_node&>(syntax_node[1]).attr->value, init);
 			return AST_result(type);
 		}},
 		{ "let Id GlobalInitExpr", [](gen_node& syntax_node, AST_context* context){
@@ -1523,7 +1568,7 @@ parser::init_rules mparse_rules =
 			case 0: init = create_initializer_list(nullptr, reinterpret_cast<init_vec*>(data.first)); break;
 			case 1: init = data.first; break;
 			}
-			context->alloc_var(init->getType(), static_cast<term_node&>(syntax_node[0]).data.attr->value, init);
+			context->alloc_var(init->getType(), static_cast<term_node&>(syntax_node[0]).attr->value, init);
 			return AST_result((Type*)nullptr);
 		}}
 	}},
@@ -1545,7 +1590,7 @@ parser::init_rules mparse_rules =
 				}
 			}
 			if (!type && !init) throw err("let clause must be initialized");
-			context->alloc_var(type ? type : init->getType(), static_cast<term_node&>(syntax_node[1]).data.attr->value, init);
+			context->alloc_var(type ? type : init->getType(), static_cast<term_node&>(syntax_node[1]).attr->value, init);
 			return AST_result(type);
 		}},
 		{ "Type Id InitExpr", [](gen_node& syntax_node, AST_context* context){
@@ -1560,7 +1605,7 @@ parser::init_rules mparse_rules =
 				case 1: init = data.first; break;
 				}
 			}
-			context->alloc_var(type, static_cast<term_node&>(syntax_node[1]).data.attr->value, init);
+			context->alloc_var(type, static_cast<term_node&>(syntax_node[1]).attr->value, init);
 			return AST_result(type);
 		}},
 		{ "let Id InitExpr", [](gen_node& syntax_node, AST_context* context){
@@ -1571,7 +1616,7 @@ parser::init_rules mparse_rules =
 			case 0: init = create_initializer_list(nullptr, reinterpret_cast<init_vec*>(data.first)); break;
 			case 1: init = data.first; break;
 			}
-			context->alloc_var(init->getType(), static_cast<term_node&>(syntax_node[0]).data.attr->value, init);
+			context->alloc_var(init->getType(), static_cast<term_node&>(syntax_node[0]).attr->value, init);
 			return AST_result((Type*)nullptr);
 		}}
 	}},
@@ -1579,12 +1624,12 @@ parser::init_rules mparse_rules =
 		{ "LocalRefDefine, Id InitExpr", [](gen_node& syntax_node, AST_context* context){
 			syntax_node[0].code_gen(context);
 			auto ptr = syntax_node[2].code_gen(context).get_as<ltype::lvalue>();
-			context->add_ref(ptr, static_cast<term_node&>(syntax_node[1]).data.attr->value);
+			context->add_ref(ptr, static_cast<term_node&>(syntax_node[1]).attr->value);
 			return AST_result();
 		}},
 		{ "ref Id InitExpr", [](gen_node& syntax_node, AST_context* context){
 			auto ptr = syntax_node[1].code_gen(context).get_as<ltype::lvalue>();
-			context->add_ref(ptr, static_cast<term_node&>(syntax_node[0]).data.attr->value);
+			context->add_ref(ptr, static_cast<term_node&>(syntax_node[0]).attr->value);
 			return AST_result();
 		}}
 	}},
@@ -1596,7 +1641,7 @@ parser::init_rules mparse_rules =
 	// Class
 	{ "Class", {
 		{ "class Id ClassBase { ClassInterface }", [](gen_node& syntax_node, AST_context* context){
-			auto& class_name =  static_cast<term_node&>(syntax_node[0]).data.attr->value;
+			auto& class_name =  static_cast<term_node&>(syntax_node[0]).attr->value;
 			Type* base = nullptr;
 			unsigned hwnd = is_public;
 			if (auto base_val = syntax_node[1].code_gen(context))
@@ -1638,7 +1683,7 @@ parser::init_rules mparse_rules =
 		{ "", parser::empty }
 	}},
 	{ "ClassInterface", {
-		{ "ClassInterfaceItem ClassInterface", parser::expand },
+		{ "ClassInterface ClassInterfaceItem", parser::expand, {}, true },
 		{ "", parser::empty }
 	}},
 	{ "ClassInterfaceItem", {
@@ -1647,7 +1692,7 @@ parser::init_rules mparse_rules =
 			if (struct_context->chk_vptr && !struct_context->type)
 			{
 				auto type = syntax_node[1].code_gen(context).get_type();
-				auto name = static_cast<term_node&>(syntax_node[2]).data.attr->value;
+				auto name = static_cast<term_node&>(syntax_node[2]).attr->value;
 				struct_context->alloc_var(type, name, nullptr);
 				struct_context->set_name_visibility(name, syntax_node[0].code_gen(context).get_attr());
 			}
@@ -1669,7 +1714,7 @@ parser::init_rules mparse_rules =
 				auto fnattr = syntax_node[1].code_gen(context).get_data<function_attr>();
 				context->collect_param_name = true;
 				context->function_param_name.resize(0);
-				auto name = static_cast<term_node&>(syntax_node[3]).data.attr->value;
+				auto name = static_cast<term_node&>(syntax_node[3]).attr->value;
 				auto base_type = syntax_node[2].code_gen(context).get_type();
 				if (base_type->isArrayTy())
 					throw err("function cannot return an array");
@@ -1708,7 +1753,7 @@ parser::init_rules mparse_rules =
 				function_attr fnattr = {is_method};
 				context->collect_param_name = true;
 				context->function_param_name.resize(0);
-				auto name = static_cast<term_node&>(syntax_node[2]).data.attr->value;
+				auto name = static_cast<term_node&>(syntax_node[2]).attr->value;
 				auto base_type = syntax_node[1].code_gen(context).get_type();
 				if (base_type->isArrayTy())
 					throw err("function cannot return an array");
@@ -1746,6 +1791,8 @@ parser::init_rules mparse_rules =
 			if (fnattr->count(attr)) throw err("function attribute redeclared");
 			fnattr->insert(attr);
 			if (attr == is_override) fnattr->insert(is_virtual);
+			if (fnattr->count(is_inline) && fnattr->count(is_noinline))
+				throw err("function cannot be both inline and noinline");
 			return AST_result(fnattr);
 		}},
 		{ "MethodAttrElem", [](gen_node& syntax_node, AST_context* context){
@@ -1758,6 +1805,7 @@ parser::init_rules mparse_rules =
 	{ "MethodAttrElem", {
 		{ "virtual", parser::attribute<is_virtual> },
 		{ "override", parser::attribute<is_override> },
+		{ "FunctionAttrElem", parser::forward },
 	}},
 	{ "VisitAttr", {
 		{ "private", parser::attribute<is_private> },
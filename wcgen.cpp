@@ -0,0 +1,29 @@
+#include "wc.h"
+#include <fstream>
+
+// build the parser from the rules in wc.h once and write its tables as a header,
+// wc.cpp compiled with WC_PRECOMPILED_TABLES includes it instead of building them at startup
+// usage: wcgen wc_tables.h
+int main(int argc, char *argv[])
+{
+	try
+	{
+		if (argc != 2) throw err("usage: wcgen <output header>");
+		auto key = parser::grammar_hash(mlex_rules, mparse_rules, mexpr_rules, rep_list, "S", slr_lookahead);
+		parser mparser(mlex_rules, mparse_rules, mexpr_rules, rep_list);		// expr_gen changes the rules
+		parser::table_image image;
+		mparser.export_tables(image);
+		image.key = key;
+		std::ofstream os(argv[1]);
+		if (!os) throw err(std::string("cannot open file: ") + argv[1]);
+		image.write_source(os, "wc_tables");
+		os.close();
+		if (!os) throw err(std::string("cannot write file: ") + argv[1]);
+	}
+	catch (const err& e)
+	{
+		e.alert();
+		return 1;
+	}
+	return 0;
+}